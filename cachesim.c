@@ -0,0 +1,1219 @@
+/* cachesim.c - The simulated memory hierarchy of csim, see csim.c for the simulated features and cachesim.h for the
+ * interface */
+
+#define _POSIX_C_SOURCE 200809L
+#include "cachesim.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+/* The value of a macro as a string literal, for the messages naming a limit */
+#define STRING(x) #x
+#define STRINGIFY(x) STRING(x)
+/* The message of a cache whose geometry is out of range, named with the options giving it */
+#define GEOMETRY_PROBLEM(cache, options) "the " cache " (" options ") needs 0 <= s <= " STRINGIFY(MAX_SET_BITS) \
+    ", 1 <= E <= " STRINGIFY(MAX_ASSOC) ", b >= 0 and s + b < 64"
+
+profile *sim_profile;
+
+void sim_config_init(sim_config *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg -> s = cfg -> assoc = cfg -> b = -1;
+    cfg -> sector_bits = -1;
+    cfg -> index_fn = INDEX_MODULO;
+    cfg -> flush_policy = FLUSH_NONE;
+    cfg -> nt_policy = NT_BYPASS;
+    cfg -> map_policy = MAP_NONE;
+}
+
+int sim_parse_option(sim_config *cfg, int opt, const char *arg) {
+    switch(opt) {
+        case 's':
+            cfg -> s = atoi(arg);
+            return 1;
+        case 'E':
+            cfg -> assoc = atoi(arg);
+            return 1;
+        case 'b':
+            cfg -> b = atoi(arg);
+            return 1;
+        case 'v':
+            cfg -> verbose = 1;
+            return 1;
+        case 'a':
+            cfg -> asid_tags = 1;
+            return 1;
+        case 'F':
+            cfg -> flush_policy = parse_flush_policy(arg, &cfg -> flush_percent);
+            return (cfg -> flush_policy < 0) ? -1 : 1;
+        case 'T':
+            cfg -> tlb_entries = atoi(arg);
+            return 1;
+        case 'P':
+            cfg -> map_policy = parse_map_policy(arg);
+            return (cfg -> map_policy < 0) ? -1 : 1;
+        case 'I':
+            cfg -> index_fn = parse_index_function(arg);
+            return (cfg -> index_fn < 0) ? -1 : 1;
+        case 'S':
+            cfg -> num_sets = atoi(arg);
+            /* -S replaces -s, s is derived from the number of sets by simulator_init */
+            if (cfg -> s < 0) {
+                cfg -> s = 0;
+            }
+            return 1;
+        case 'B':
+            cfg -> sector_bits = atoi(arg);
+            return 1;
+        case 'z':
+            cfg -> honor_size = 1;
+            return 1;
+        case 'i':
+            cfg -> icache = 1;
+            return parse_geometry(arg, &cfg -> i_s, &cfg -> i_E, &cfg -> i_b) ? 1 : -1;
+        case 'L':
+            cfg -> l2cache = 1;
+            return parse_geometry(arg, &cfg -> l2_s, &cfg -> l2_E, &cfg -> l2_b) ? 1 : -1;
+        case 'n':
+            cfg -> nt_policy = parse_nt_policy(arg);
+            return (cfg -> nt_policy < 0) ? -1 : 1;
+        case 'c':
+            cfg -> coalesce = 1;
+            return 1;
+    }
+    return 0;
+}
+
+int sim_config_complete(const sim_config *cfg) {
+    return (cfg -> s >= 0) && (cfg -> assoc >= 0) && (cfg -> b >= 0);
+}
+
+const char *sim_parse_args(sim_config *cfg, char *args[], int n) {
+/* sim_parse_args applies the options of a configuration given as words, for the tools which cannot use getopt */
+    sim_config_init(cfg);
+    for (int i = 0; i < n; i++) {
+        const char *letter = (args[i][0] == '-') && (args[i][1] != '\0') && (args[i][1] != ':') &&
+                             (args[i][2] == '\0') ? strchr(SIM_OPTIONS, args[i][1]) : NULL;
+        const char *arg = NULL;
+        if (letter == NULL) {
+            return "unknown option";
+        }
+        if (letter[1] == ':') {
+            if (i + 1 == n) {
+                return "missing option argument";
+            }
+            arg = args[++i];
+        }
+        if (sim_parse_option(cfg, *letter, arg) <= 0) {
+            return "malformed option";
+        }
+    }
+    if (!sim_config_complete(cfg)) {
+        return "the geometry of the cache (-s, -E and -b) is missing";
+    }
+    return NULL;
+}
+
+int sim_config_key(const sim_config *cfg, char *buf, int size) {
+/* Every field takes part, even those whose value cannot change the result, so that two equal keys always describe the
+ * same simulation */
+    int n = snprintf(buf, size, "s:%d E:%d b:%d S:%d B:%d I:%d i:%d:%d:%d:%d L:%d:%d:%d:%d v:%d a:%d z:%d c:%d F:%d:%d "
+                     "n:%d T:%d P:%d", cfg -> s, cfg -> assoc, cfg -> b, cfg -> num_sets, cfg -> sector_bits,
+                     cfg -> index_fn, cfg -> icache, cfg -> i_s, cfg -> i_E, cfg -> i_b, cfg -> l2cache, cfg -> l2_s,
+                     cfg -> l2_E, cfg -> l2_b, cfg -> verbose, cfg -> asid_tags, cfg -> honor_size, cfg -> coalesce,
+                     cfg -> flush_policy, cfg -> flush_percent, cfg -> nt_policy, cfg -> tlb_entries,
+                     cfg -> map_policy);
+    return (n >= 0) && (n < size);
+}
+
+static int geometry_valid(int s, int assoc, int b) {
+/* Checked before any shift by s or b */
+    return (s >= 0) && (s <= MAX_SET_BITS) && (assoc >= 1) && (assoc <= MAX_ASSOC) && (b >= 0) && (s + b < 64);
+}
+
+const char *sim_config_check(const sim_config *cfg) {
+    int s = cfg -> s;
+    if (cfg -> num_sets > 0) {
+        for (s = 0; (2LL << s) <= cfg -> num_sets; s++);
+    }
+    if ((cfg -> num_sets < 0) || !geometry_valid(s, cfg -> assoc, cfg -> b)) {
+        return GEOMETRY_PROBLEM("L1 data cache", "-s or -S, -E, -b");
+    }
+    if (cfg -> icache && !geometry_valid(cfg -> i_s, cfg -> i_E, cfg -> i_b)) {
+        return GEOMETRY_PROBLEM("L1 instruction cache", "-i");
+    }
+    if (cfg -> l2cache && !geometry_valid(cfg -> l2_s, cfg -> l2_E, cfg -> l2_b)) {
+        return GEOMETRY_PROBLEM("L2 cache", "-L");
+    }
+    int sector_bits = (cfg -> sector_bits >= 0) ? cfg -> sector_bits : cfg -> b;
+    if ((sector_bits > cfg -> b) || (cfg -> b - sector_bits > 62) ||
+        ((1LL << (cfg -> b - sector_bits)) > MAX_SECTORS)) {
+        return "a line holds between 1 and " STRINGIFY(MAX_SECTORS) " sectors";
+    }
+    return NULL;
+}
+
+int simulator_init(simulator *sim, const sim_config *cfg) {
+/* simulator_init builds the hierarchy, the TLB and the page allocator described by cfg */
+    const char *problem = sim_config_check(cfg);
+    if (problem != NULL) {
+        fprintf(stderr, "%s\n", problem);
+        return 0;
+    }
+    int s = cfg -> s, b = cfg -> b, assoc = cfg -> assoc;
+    int num_sets = (1 << s);
+    if (cfg -> num_sets) {
+        num_sets = cfg -> num_sets;
+        for (s = 0; (2 << s) <= num_sets; s++);
+    }
+    int sector_bits = (cfg -> sector_bits >= 0) ? cfg -> sector_bits : b;
+
+    memset(sim, 0, sizeof(*sim));
+    sim -> verbose = cfg -> verbose;
+    sim -> asid_tags = cfg -> asid_tags;
+    sim -> honor_size = cfg -> honor_size;
+    sim -> sectored = (cfg -> sector_bits >= 0);
+    sim -> flush_policy = cfg -> flush_policy;
+    sim -> flush_percent = cfg -> flush_percent;
+    sim -> flush_rng = FLUSH_SEED;
+    sim -> nt_policy = cfg -> nt_policy;
+    sim -> icache = cfg -> icache;
+    sim -> l2cache = cfg -> l2cache;
+    sim -> tlb_entries = cfg -> tlb_entries;
+    sim -> map_policy = cfg -> map_policy;
+    /* The outcome of every access can only be printed if every access is looked up */
+    sim -> coalesce = cfg -> coalesce && !cfg -> verbose;
+
+    cache_init(&sim -> l1d, "L1d", s, num_sets, assoc, b, sector_bits, cfg -> index_fn);
+    if (sim -> icache) {
+        cache_init(&sim -> l1i, "L1i", cfg -> i_s, 1 << cfg -> i_s, cfg -> i_E, cfg -> i_b, cfg -> i_b,
+                   cfg -> index_fn);
+    }
+    if (sim -> l2cache) {
+        cache_init(&sim -> l2, "L2", cfg -> l2_s, 1 << cfg -> l2_s, cfg -> l2_E, cfg -> l2_b, cfg -> l2_b,
+                   cfg -> index_fn);
+    }
+
+    if (sim -> tlb_entries > 0) {
+        sim -> tlb = (tlb_entry *)malloc(sim -> tlb_entries*sizeof(tlb_entry));
+        for (int i = 0; i < sim -> tlb_entries; i++) {
+            sim -> tlb[i].valid = 0;
+            sim -> tlb[i].lru_cntr = i;
+        }
+    }
+
+    /* Page colors are the distinct page-sized slices of one way of the last level cache */
+    page_map_init(&sim -> pmap, sim -> map_policy, sim -> l2cache ? cfg -> l2_s + cfg -> l2_b : s + b);
+    return 1;
+}
+
+static void cache_free(cache *c) {
+    for (int i = 0; i < c -> num_sets; i++) {
+        free(c -> sets[i]);
+    }
+    free(c -> sets);
+}
+
+void simulator_free(simulator *sim) {
+    cache_free(&sim -> l1d);
+    if (sim -> icache) {
+        cache_free(&sim -> l1i);
+    }
+    if (sim -> l2cache) {
+        cache_free(&sim -> l2);
+    }
+    free(sim -> tlb);
+    free(sim -> pmap.next_in_color);
+    free(sim -> pmap.entries);
+    free(sim -> pmap.frames_used);
+}
+
+void simulate_record(simulator *sim, const trace_record *rec) {
+/* simulate_record applies one record of the trace, which may be a run of accesses, to the simulated system */
+    long long address = rec -> address;
+    char access_type = rec -> type;
+    int record_asid;
+
+    if (sim -> coalesce && coalesce_access(sim, rec)) {
+        return;
+    }
+
+    if (access_type == 'X') {
+        /* Context switch to the address space rec -> asid */
+        if (rec -> asid != sim -> cur_asid) {
+            sim -> context_switches++;
+            if (sim -> flush_policy != FLUSH_NONE) {
+                int percent = (sim -> flush_policy == FLUSH_FULL) ? 100 : sim -> flush_percent;
+                sim -> lines_flushed += flush_cache(&sim -> l1d, percent, &sim -> flush_rng, &sim -> flush_writebacks);
+                if (sim -> icache) {
+                    sim -> lines_flushed += flush_cache(&sim -> l1i, percent, &sim -> flush_rng,
+                                                        &sim -> flush_writebacks);
+                }
+                if (sim -> l2cache) {
+                    sim -> lines_flushed += flush_cache(&sim -> l2, percent, &sim -> flush_rng,
+                                                        &sim -> flush_writebacks);
+                }
+            }
+            /* Without ASIDs the TLB cannot tell the translations of the two processes apart */
+            if (sim -> tlb && !sim -> asid_tags) {
+                tlb_shootdown(sim -> tlb, sim -> tlb_entries, -1);
+            }
+            sim -> cur_asid = rec -> asid;
+        }
+        return;
+    }
+    if (access_type == 'K') {
+        if (sim -> tlb) {
+            sim -> tlb_shootdowns++;
+            tlb_shootdown(sim -> tlb, sim -> tlb_entries, sim -> asid_tags ? rec -> asid : -1);
+        }
+        return;
+    }
+
+    if (rec -> count > 1) {
+        /* A run is a group with a single member */
+        simulate_group(sim, rec, 1, rec -> count);
+        return;
+    }
+    record_asid = record_asid_of(sim, rec);
+    simulate_access(sim, access_type, address, rec -> size, record_asid);
+}
+
+int coalesce_access(simulator *sim, const trace_record *rec) {
+/* coalesce_access passes a record through the coalescing filter and returns 0 if the record has to be simulated by
+ * the caller, after the accesses held back by the filter have been simulated */
+    char access_type = rec -> type;
+    if ((rec -> count != 1) || ((access_type != 'L') && (access_type != 'S') && (access_type != 'M') &&
+                                (access_type != 'I'))) {
+        coalesce_flush(sim);
+        return 0;
+    }
+    if ((access_type == 'I') && !sim -> icache) {
+        /* Ignored instruction fetches do not separate the data accesses around them */
+        return 1;
+    }
+
+    cache *c = (access_type == 'I') ? &sim -> l1i : &sim -> l1d;
+    int asid = record_asid_of(sim, rec);
+    long long last_byte = rec -> address;
+    if (sim -> honor_size && (rec -> size > 1)) {
+        last_byte += rec -> size - 1;
+    }
+    if ((last_byte >> c -> sector_bits) != (rec -> address >> c -> sector_bits)) {
+        coalesce_flush(sim);
+        return 0;
+    }
+
+    /* A single pending line is kept, so the accesses are never reordered, even between the two L1 caches */
+    if (sim -> pending_count && ((sim -> pending.type == 'I') == (access_type == 'I')) &&
+        (sim -> pending_asid == asid) &&
+        ((sim -> pending.address >> c -> sector_bits) == (rec -> address >> c -> sector_bits))) {
+        sim -> pending_count++;
+    } else {
+        coalesce_flush(sim);
+        sim -> pending = *rec;
+        sim -> pending_asid = asid;
+        sim -> pending_count = 1;
+        sim -> pending_write = 0;
+        sim -> pending_modifies = 0;
+    }
+    sim -> pending_write |= (access_type == 'S') || (access_type == 'M');
+    sim -> pending_modifies += (access_type == 'M');
+    return 1;
+}
+
+void simulate_records(simulator *sim, const trace_record recs[], long long n) {
+/* simulate_records simulates a trace held in memory as it is read from a file, the members of every group following
+ * its 'R' record */
+    for (long long i = 0; i < n; ) {
+        if (recs[i].type == 'R') {
+            simulate_group(sim, &recs[i + 1], recs[i].size, recs[i].count);
+            i += 1 + recs[i].size;
+        } else {
+            simulate_record(sim, &recs[i]);
+            i++;
+        }
+    }
+    coalesce_flush(sim);
+}
+
+void simulate_batch(void *sim, const trace_record recs[], int n) {
+    for (int i = 0; i < n; i++) {
+        simulate_record((simulator *)sim, &recs[i]);
+    }
+}
+
+void coalesce_flush(simulator *sim) {
+/* coalesce_flush simulates the accesses held back by the coalescing filter: one lookup, which writes the line if any
+ * of the accesses did, and a hit for each of the others and for the store half of every 'M' */
+    if (sim -> pending_count == 0) {
+        return;
+    }
+    int instruction = (sim -> pending.type == 'I');
+    cache *c = instruction ? &sim -> l1i : &sim -> l1d;
+    long long repeats = sim -> pending_count - 1;
+
+    simulate_access(sim, instruction ? 'I' : (sim -> pending_write ? 'S' : 'L'), sim -> pending.address,
+                    sim -> pending.size, sim -> pending_asid);
+    c -> hits += repeats + sim -> pending_modifies;
+    c -> access_count += repeats;
+    /* The repeated accesses hit the TLB entry of the page just looked up */
+    if (sim -> tlb && !instruction) {
+        sim -> tlb_hits += repeats;
+    }
+    sim -> coalesced_accesses += repeats;
+    sim -> pending_count = 0;
+}
+
+int record_asid_of(simulator *sim, const trace_record *rec) {
+/* The ASID of a record overrides the one set by the last context switch. Without ASID-aware tags all processes share
+ * one address space and their addresses collide */
+    if (!sim -> asid_tags) {
+        return 0;
+    }
+    return (rec -> asid >= 0) ? rec -> asid : sim -> cur_asid;
+}
+
+void simulate_group(simulator *sim, const trace_record members[], int p, long long count) {
+/* simulate_group simulates count repetitions of the p interleaved members of a group. See the header of csim.c for why
+ * skipping the repetitions that stay within the lines of the first one gives exactly the result of simulating them */
+    cache *l1 = &sim -> l1d;
+    int asid[TRACE_MAX_GROUP], fast = 1, modifies = 0;
+    const long long LINE_MASK = (1LL << l1 -> b) - 1;
+
+    coalesce_flush(sim);
+
+    sim -> runs++;
+    /* The fast path only applies to plain loads and stores when no feature needs to observe every access */
+    if (sim -> verbose || sim -> tlb || sim -> honor_size || sim -> sectored || (sim -> map_policy != MAP_NONE)) {
+        fast = 0;
+    }
+    for (int i = 0; i < p; i++) {
+        asid[i] = record_asid_of(sim, &members[i]);
+        if ((members[i].type != 'L') && (members[i].type != 'S') && (members[i].type != 'M')) {
+            fast = 0;
+        }
+        modifies += (members[i].type == 'M');
+    }
+
+    for (long long k = 0; k < count; ) {
+        /* The number of repetitions, starting with this one, in which every member stays in its current line */
+        long long same_line = count - k;
+        for (int i = 0; i < p; i++) {
+            long long address = members[i].address + k * members[i].stride;
+            long long in_line = same_line;
+            if (members[i].stride > 0) {
+                in_line = ((address | LINE_MASK) - address) / members[i].stride + 1;
+            } else if (members[i].stride < 0) {
+                in_line = (address - (address & ~LINE_MASK)) / -(members[i].stride) + 1;
+            }
+            if (in_line < same_line) {
+                same_line = in_line;
+            }
+        }
+
+        for (int i = 0; i < p; i++) {
+            simulate_access(sim, members[i].type, members[i].address + k * members[i].stride, members[i].size,
+                            asid[i]);
+        }
+        k++;
+        if (!fast || (same_line == 1)) {
+            continue;
+        }
+
+        int set_index, resident = 1;
+        for (int i = 0; i < p; i++) {
+            if (cache_find(l1, members[i].address + (k - 1) * members[i].stride, asid[i], &set_index) == NULL) {
+                resident = 0;
+            }
+        }
+        if (resident) {
+            l1 -> hits += (same_line - 1) * (p + modifies);
+            l1 -> access_count += (same_line - 1) * p;
+            sim -> fast_path_accesses += (same_line - 1) * p;
+            k += same_line - 1;
+        }
+    }
+}
+
+void simulate_access(simulator *sim, char access_type, long long address, int size, int record_asid) {
+/* simulate_access looks up a single access of the trace in the hierarchy */
+    if ((access_type == 'I') && !sim -> icache) {
+        /* Ignore instruction references unless an instruction cache is simulated */
+        return;
+    }
+    cache *l1 = (access_type == 'I') ? &sim -> l1i : &sim -> l1d;
+    int b = l1 -> b;
+
+    if (access_type == 'F') {
+        /* clflush removes the line from every level, a dirty copy is written back to memory */
+        int dirty;
+        sim -> hint_records++;
+        sim -> clflushes++;
+        if (sim -> map_policy != MAP_NONE) {
+            address = translate(&sim -> pmap, address, record_asid);
+        }
+        dirty = cache_invalidate(&sim -> l1d, address, record_asid);
+        if (sim -> l2cache) {
+            dirty |= cache_invalidate(&sim -> l2, address, record_asid);
+        }
+        sim -> clflush_writebacks += dirty;
+        if (sim -> verbose) {
+            printf("%c, %llx, flush%s\n", access_type, address, dirty ? " writeback" : "");
+        }
+        return;
+    }
+    if ((access_type == 'N') || (access_type == 'P')) {
+        sim -> hint_records++;
+    }
+
+    /* Without -z every access is assumed to lie within a single line, as in the reference simulator. Otherwise an
+     * access straddling line boundaries is split into one lookup per line it touches */
+    long long vaddr = address;
+    long long last_byte = address;
+    if (sim -> honor_size && (size > 1)) {
+        last_byte = address + size - 1;
+    }
+    if ((last_byte >> b) != (address >> b)) {
+        sim -> split_accesses++;
+        sim -> line_lookups += (last_byte >> b) - (address >> b) + 1;
+    }
+
+    for (long long piece = vaddr; piece <= last_byte; piece = ((piece >> b) + 1) << b) {
+        int set_index, result;
+        writeback victim;
+        long long piece_end = (((piece >> b) + 1) << b) - 1;
+        if (piece_end > last_byte) {
+            piece_end = last_byte;
+        }
+
+        /* The TLB is only consulted again when the access crosses into another page */
+        if (sim -> tlb && (access_type != 'I') && ((piece == vaddr) || ((piece & ((1LL << sim -> pmap.page_bits) - 1)) == 0))) {
+            if (tlb_lookup(sim -> tlb, sim -> tlb_entries, piece >> sim -> pmap.page_bits, record_asid)) {
+                sim -> tlb_hits++;
+            } else {
+                sim -> tlb_misses++;
+            }
+        }
+
+        address = piece;
+        if (sim -> map_policy != MAP_NONE) {
+            address = translate(&sim -> pmap, piece, record_asid);
+        }
+
+        int flags = 0;
+        if ((access_type == 'S') || (access_type == 'M') || (access_type == 'N')) {
+            flags |= ACCESS_WRITE;
+        }
+        if (access_type == 'N') {
+            flags |= (sim -> nt_policy == NT_BYPASS) ? ACCESS_NO_ALLOCATE : ACCESS_LOW_PRIORITY;
+        } else if (access_type == 'P') {
+            flags |= ACCESS_PREFETCH;
+        }
+
+        result = cache_access(l1, address, address + piece_end - piece, record_asid, flags, &set_index, &victim);
+        if (sim -> verbose) {
+            unsigned long long start = profile_begin(PROFILE_OUTPUT);
+            printf("%c, %llx, set = %d ", access_type, address, set_index);
+            if (access_type == 'P') {
+                printf("prefetch %s", (result == ACCESS_HIT) ? "hit" : "fill");
+            } else if (result == ACCESS_BYPASS) {
+                printf("bypass");
+            } else if (result == ACCESS_HIT) {
+                printf("hit");
+            } else {
+                printf("miss %lld %s", l1 -> misses, (result == ACCESS_SECTOR_MISS) ? "sector" :
+                                                     (result == ACCESS_MISS_EVICTION) ? "eviction" : "");
+            }
+            profile_end(PROFILE_OUTPUT, start);
+        }
+
+        if (sim -> l2cache) {
+            /* The L2 is read for every L1 miss and written with the dirty line the L1 had to evict. A prefetch
+             * fills both levels and a bypassing store is passed on to the L2, which it may bypass as well */
+            if (result != ACCESS_HIT) {
+                writeback l2_victim;
+                int l2_set;
+                result = cache_access(&sim -> l2, address, address + piece_end - piece, record_asid,
+                                      flags & (ACCESS_PREFETCH | ACCESS_NO_ALLOCATE |
+                                               ((result == ACCESS_BYPASS) ? ACCESS_WRITE : 0)),
+                                      &l2_set, &l2_victim);
+                if (sim -> verbose) {
+                    unsigned long long start = profile_begin(PROFILE_OUTPUT);
+                    printf(" L2 %s", (result == ACCESS_HIT) ? "hit" : (result == ACCESS_BYPASS) ? "bypass" : "miss");
+                    profile_end(PROFILE_OUTPUT, start);
+                }
+            }
+            if (victim.valid) {
+                writeback l2_victim;
+                int l2_set;
+                cache_access(&sim -> l2, victim.address, victim.address, victim.asid, ACCESS_WRITE, &l2_set, &l2_victim);
+            }
+        }
+        if (sim -> verbose) {
+            unsigned long long start = profile_begin(PROFILE_OUTPUT);
+            printf("\n");
+            profile_end(PROFILE_OUTPUT, start);
+        }
+
+        /* An 'M' or modify type of access reads a value and writes to the same location. So, irrespective of the
+         * result of the read, the write is always a hit */
+        if (access_type == 'M') {
+            sim -> l1d.hits++;
+        }
+    }
+}
+
+void print_statistics(simulator *sim, FILE *out) {
+/* print_statistics prints the statistics of the features in use and of the levels besides the L1 data cache, whose
+ * summary is left to the caller */
+    cache *l1d = &sim -> l1d;
+    if (sim -> honor_size) {
+        fprintf(out, "split_accesses:%lld line_lookups:%lld\n", sim -> split_accesses, sim -> line_lookups);
+    }
+    if (sim -> context_switches || sim -> tlb) {
+        fprintf(out, "context_switches:%lld lines_flushed:%lld flush_writebacks:%lld\n", sim -> context_switches,
+                sim -> lines_flushed, sim -> flush_writebacks);
+    }
+    if (sim -> tlb) {
+        fprintf(out, "tlb_hits:%lld tlb_misses:%lld tlb_shootdowns:%lld\n", sim -> tlb_hits, sim -> tlb_misses,
+                    sim -> tlb_shootdowns);
+    }
+    if (sim -> map_policy != MAP_NONE) {
+        fprintf(out, "pages_mapped:%lld\n", sim -> pmap.pages_mapped);
+    }
+    if (sim -> sectored) {
+        fprintf(out, "tag_misses:%lld sector_misses:%lld bytes_fetched:%lld dirty_sector_writebacks:%lld\n",
+                    l1d -> tag_misses, l1d -> sector_misses, l1d -> sectors_fetched << l1d -> sector_bits,
+                    l1d -> writebacks);
+    }
+    if (sim -> hint_records) {
+        fprintf(out, "prefetch_fills:%lld useful_prefetches:%lld polluting_prefetches:%lld nt_bypasses:%lld "
+                    "clflushes:%lld clflush_writebacks:%lld\n", l1d -> prefetch_fills, l1d -> useful_prefetches,
+                    l1d -> useless_prefetches, l1d -> bypasses, sim -> clflushes, sim -> clflush_writebacks);
+    }
+    if (l1d -> index_sets != l1d -> num_sets) {
+        fprintf(out, "sets_used:%d of %d\n", l1d -> index_sets, l1d -> num_sets);
+    }
+    if (sim -> coalesce) {
+        fprintf(out, "coalesced_accesses:%lld\n", sim -> coalesced_accesses);
+    }
+    if (sim -> runs) {
+        fprintf(out, "runs:%lld fast_path_accesses:%lld\n", sim -> runs, sim -> fast_path_accesses);
+    }
+    if (sim -> icache) {
+        print_level(&sim -> l1i, out);
+    }
+    if (sim -> l2cache) {
+        print_level(&sim -> l2, out);
+    }
+}
+
+void cache_init(cache *c, const char *name, int s, int num_sets, int assoc, int b, int sector_bits, int index_fn) {
+/* cache_init allocates an empty cache with the given geometry */
+    c -> name = name;
+    c -> s = s;
+    c -> b = b;
+    c -> assoc = assoc;
+    c -> num_sets = num_sets;
+    c -> index_fn = index_fn;
+    c -> sector_bits = sector_bits;
+    c -> full_block_tag = (index_fn != INDEX_MODULO) || (num_sets != (1 << s));
+    c -> access_count = 0;
+    c -> hits = c -> misses = c -> evictions = 0;
+    c -> tag_misses = c -> sector_misses = c -> writebacks = 0;
+    c -> sectors_fetched = 0;
+    c -> prefetch_fills = c -> useful_prefetches = c -> useless_prefetches = c -> bypasses = 0;
+
+    /* Prime modulo indexing only uses the sets up to the largest prime not exceeding num_sets */
+    c -> index_sets = num_sets;
+    if (index_fn == INDEX_PRIME) {
+        for (int prime = 0; !prime && (c -> index_sets > 2); ) {
+            prime = 1;
+            for (int d = 2; d*d <= c -> index_sets; d++) {
+                if (c -> index_sets % d == 0) {
+                    prime = 0;
+                    c -> index_sets--;
+                    break;
+                }
+            }
+        }
+    }
+
+    c -> sets = (cache_line **)malloc(num_sets*sizeof(cache_line *));
+    for (int i = 0; i < num_sets; i++) {
+        c -> sets[i] = (cache_line *)malloc(assoc*sizeof(cache_line));
+    }
+
+    for (int i = 0; i < num_sets; i++) {
+        for (int j = 0; j < assoc; j++) {
+            c -> sets[i][j].valid = 0;
+            c -> sets[i][j].asid = 0;
+            c -> sets[i][j].stamp = 0;
+            c -> sets[i][j].prefetched = 0;
+            c -> sets[i][j].sector_valid = 0;
+            c -> sets[i][j].sector_dirty = 0;
+            /* Initializing with j ensures that all the lru_cntr values are distinct as is the case with normal
+             * operation */
+            c -> sets[i][j].lru_cntr = j; 
+        }
+    }
+}
+
+int cache_access(cache *c, long long address, long long last_byte, int asid, int flags, int *set_index,
+                 writeback *victim) {
+/* cache_access looks up the bytes from address to last_byte, which must lie in one line, updates the statistics of
+ * the cache and returns the access_result. If a dirty line had to be evicted, it is returned through victim. The
+ * flags are a combination of the ACCESS_ values */
+    long long tag;
+    cache_line *line_to_replace, *hit_line;
+    unsigned long long sector_bits_touched;
+    const int SECTOR_MASK = (1 << (c -> b - c -> sector_bits)) - 1;
+    int result;
+
+    victim -> valid = 0;
+    if (!c -> full_block_tag) {
+        *set_index = (address >> c -> b) & ((1 << c -> s) - 1);
+        tag = address >> (c -> s + c -> b);
+    } else {
+        tag = address >> c -> b;
+        *set_index = set_index_of(c -> index_fn, tag, c -> s, c -> index_sets, 0);
+    }
+
+    /* A store that must not allocate leaves the cache untouched unless the line is already present */
+    if ((flags & ACCESS_NO_ALLOCATE) && (cache_find(c, address, asid, set_index) == NULL)) {
+        c -> bypasses++;
+        return ACCESS_BYPASS;
+    }
+
+    c -> access_count++;
+    unsigned long long start = profile_begin(PROFILE_LOOKUP);
+    if (c -> index_fn == INDEX_SKEW) {
+        line_to_replace = skew_lookup(c -> sets, c -> assoc, c -> num_sets, c -> s, tag, asid, c -> access_count,
+                                      &hit_line);
+    } else {
+        line_to_replace = cache_lookup(c -> sets[*set_index], c -> assoc, tag, asid, &hit_line);
+    }
+    profile_end(PROFILE_LOOKUP, start);
+    /* The sectors of the line covered by the access */
+    sector_bits_touched = (2ULL << ((last_byte >> c -> sector_bits) & SECTOR_MASK))
+                          - (1ULL << ((address >> c -> sector_bits) & SECTOR_MASK));
+    if ((line_to_replace == NULL) && ((hit_line -> sector_valid & sector_bits_touched) == sector_bits_touched)) {
+        result = ACCESS_HIT;
+        if (!(flags & ACCESS_PREFETCH)) {
+            c -> hits++;
+            if (hit_line -> prefetched) {
+                c -> useful_prefetches++;
+                hit_line -> prefetched = 0;
+            }
+        }
+    } else if (line_to_replace == NULL) {
+        /* The tag is present, only the missing sectors have to be fetched */
+        if (flags & ACCESS_PREFETCH) {
+            c -> prefetch_fills++;
+        } else {
+            c -> misses++;
+            c -> sector_misses++;
+        }
+        c -> sectors_fetched += __builtin_popcountll(sector_bits_touched & ~(hit_line -> sector_valid));
+        hit_line -> sector_valid |= sector_bits_touched;
+        result = ACCESS_SECTOR_MISS;
+    } else {
+        if (flags & ACCESS_PREFETCH) {
+            c -> prefetch_fills++;
+        } else {
+            c -> misses++;
+            c -> tag_misses++;
+        }
+        c -> sectors_fetched += __builtin_popcountll(sector_bits_touched);
+        result = ACCESS_MISS;
+        if (line_to_replace -> valid) {
+            c -> evictions++;
+            result = ACCESS_MISS_EVICTION;
+            if (line_to_replace -> prefetched) {
+                /* The prefetched line polluted the cache without ever being used */
+                c -> useless_prefetches++;
+            }
+            if (line_to_replace -> sector_dirty) {
+                c -> writebacks += __builtin_popcountll(line_to_replace -> sector_dirty);
+                victim -> valid = 1;
+                victim -> asid = line_to_replace -> asid;
+                victim -> address = c -> full_block_tag ? (line_to_replace -> tag << c -> b)
+                                    : (((line_to_replace -> tag << c -> s) | *set_index) << c -> b);
+            }
+        } else {
+            line_to_replace -> valid = 1;
+        }
+
+        line_to_replace -> tag = tag;
+        line_to_replace -> asid = asid;
+        line_to_replace -> sector_valid = sector_bits_touched;
+        line_to_replace -> sector_dirty = 0;
+        line_to_replace -> prefetched = (flags & ACCESS_PREFETCH) != 0;
+        hit_line = line_to_replace;
+        if (flags & ACCESS_LOW_PRIORITY) {
+            demote_line(c, *set_index, hit_line);
+        }
+    }
+    if (flags & ACCESS_WRITE) {
+        hit_line -> sector_dirty |= sector_bits_touched;
+    }
+    return result;
+}
+
+cache_line *cache_find(cache *c, long long address, int asid, int *set_index) {
+/* cache_find returns the line holding address, or a nullptr if it is not cached, without updating the lru state */
+    long long tag;
+
+    if (!c -> full_block_tag) {
+        *set_index = (address >> c -> b) & ((1 << c -> s) - 1);
+        tag = address >> (c -> s + c -> b);
+    } else {
+        tag = address >> c -> b;
+        *set_index = set_index_of(c -> index_fn, tag, c -> s, c -> index_sets, 0);
+    }
+
+    for (int i = 0; i < c -> assoc; i++) {
+        cache_line *line = &c -> sets[*set_index][i];
+        if (c -> index_fn == INDEX_SKEW) {
+            line = &c -> sets[set_index_of(INDEX_SKEW, tag, c -> s, c -> num_sets, i)][i];
+        }
+        if (line -> valid && (line -> tag == tag) && (line -> asid == asid)) {
+            return line;
+        }
+    }
+    return NULL;
+}
+
+static int drop_line(cache *c, cache_line *line) {
+/* drop_line invalidates a valid line, writing back its dirty sectors as an eviction does, and returns 1 if it was
+ * dirty */
+    int dirty = (line -> sector_dirty != 0);
+    c -> writebacks += __builtin_popcountll(line -> sector_dirty);
+    line -> valid = 0;
+    line -> sector_valid = 0;
+    line -> sector_dirty = 0;
+    line -> prefetched = 0;
+    return dirty;
+}
+
+int cache_invalidate(cache *c, long long address, int asid) {
+/* cache_invalidate drops the line holding address, if any, and returns 1 if it was dirty and has to be written back */
+    int set_index, dirty = 0;
+    cache_line *line = cache_find(c, address, asid, &set_index);
+
+    if (line != NULL) {
+        dirty = drop_line(c, line);
+    }
+    return dirty;
+}
+
+void demote_line(cache *c, int set_index, cache_line *line) {
+/* demote_line makes a line the least recently used one of its set, so that it is the next to be evicted */
+    if (c -> index_fn == INDEX_SKEW) {
+        line -> stamp = 0;
+        return;
+    }
+    cache_line *set = c -> sets[set_index];
+    for (int i = 0; i < c -> assoc; i++) {
+        if (set[i].lru_cntr > line -> lru_cntr) {
+            set[i].lru_cntr--;
+        }
+    }
+    line -> lru_cntr = c -> assoc - 1;
+}
+
+cache_line *cache_lookup(cache_line set[], int assoc, long long tag, int asid, cache_line **hit_line) {
+/* cache_lookup searches all the lines in the set for a matching tag and returns the address where the incoming
+ * block is to placed in case of a cache miss or a nullptr if it is a hit, in which case the matching line is
+ * returned through hit_line */
+
+    /* Check if the required data is already present in the cache */
+    for (int i = 0; i < assoc; i++) {
+        if (set[i].valid && (set[i].tag == tag) && (set[i].asid == asid)) {
+            update_lru_cntr(set, assoc, set[i].lru_cntr); 
+            *hit_line = &set[i];
+            return NULL;
+        }
+    }
+
+    /* If the data is not present, we need to find a slot for the incoming data */
+    short max_lru_cntr = -1;
+    cache_line *lru_line = NULL;
+    for (int i = 0; i < assoc; i++) {
+        if (set[i].valid == 0) {
+            /* If an empty slot is found, no line needs to be evicted */
+            update_lru_cntr(set, assoc, set[i].lru_cntr); 
+            return &set[i];
+        } else if (set[i].lru_cntr > max_lru_cntr) {
+            /* If the set is full, evict the least recently used line */
+            max_lru_cntr = set[i].lru_cntr;
+            lru_line = &set[i];
+        }
+    }
+
+    /* The lru line must necessarily have a lru_cntr value of assoc-1 */
+    assert(max_lru_cntr == assoc-1);
+    update_lru_cntr(set, assoc, assoc-1);
+    return lru_line;
+}
+
+int set_index_of(int index_fn, long long block, int s, int num_sets, int way) {
+/* set_index_of computes the set of a block address for the given index function. Only the skewed cache uses a
+ * different function for every way, the other functions ignore the way */
+    unsigned long long x = (unsigned long long)block;
+    unsigned long long folded = 0;
+
+    switch (index_fn) {
+        case INDEX_XOR:
+            /* XOR-fold all the bits of the block address into s bits, as is done by the slice hash of LLCs */
+            if (s == 0) {
+                return 0;
+            }
+            for (; x != 0; x >>= s) {
+                folded ^= x & ((1ULL << s) - 1);
+            }
+            return (int)(folded % num_sets);
+        case INDEX_SKEW:
+            /* Way 0 keeps the conventional index, the other ways XOR the low bits with a different multiplicative
+             * hash of the tag bits so that blocks conflicting in one way are spread over distinct sets in the others */
+            if (way > 0) {
+                folded = ((x >> s) * (0x9E3779B97F4A7C15ULL + 2*(unsigned long long)way)) >> 32;
+                x ^= folded;
+            }
+            return (int)(x % num_sets);
+        default:
+            /* Both the plain and the prime modulo index, for set counts that are not a power of two */
+            return (int)(x % num_sets);
+    }
+}
+
+cache_line *skew_lookup(cache_line *cache[], int assoc, int num_sets, int s, long long block, int asid, long long now,
+                        cache_line **hit_line) {
+/* skew_lookup is the cache_lookup of a skewed-associative cache, where every way is indexed by its own function. Way i
+ * of the cache is made up of the lines cache[*][i]. The candidates for replacement are the lines the block maps to in
+ * each way, and the least recently used one among them is picked by comparing the access stamps */
+    cache_line *victim = NULL;
+
+    for (int i = 0; i < assoc; i++) {
+        cache_line *line = &cache[set_index_of(INDEX_SKEW, block, s, num_sets, i)][i];
+        if (line->valid && (line->tag == block) && (line->asid == asid)) {
+            line->stamp = now;
+            *hit_line = line;
+            return NULL;
+        }
+        if ((victim == NULL) || (victim->valid && (!line->valid || (line->stamp < victim->stamp)))) {
+            victim = line;
+        }
+    }
+    victim->stamp = now;
+    return victim;
+}
+
+void update_lru_cntr(cache_line set[], int assoc, short lru_cntr_accessed) {
+    /* All the lines in the set with lru_cntr values less than that of the accessed block must be incremented and the
+     * accessed block must have a lru_cntr value of 0 */
+    unsigned long long start = profile_begin(PROFILE_LRU);
+    for (int i = 0; i < assoc; i++) {
+        if (set[i].lru_cntr < lru_cntr_accessed) {
+            set[i].lru_cntr++;
+        } else if (set[i].lru_cntr == lru_cntr_accessed) {
+            set[i].lru_cntr = 0;
+        }
+    }
+    profile_end(PROFILE_LRU, start);
+}
+
+int flush_cache(cache *c, int flush_percent, unsigned long long *rng, long long *dirty_lines) {
+/* flush_cache models the cache pollution of a context switch by invalidating flush_percent percent of the valid lines,
+ * picked at random by the generator of state rng, and returns the number of lines invalidated. The dirty ones are
+ * written back as if evicted, and counted in dirty_lines. The state belongs to the simulator and is seeded by
+ * simulator_init, so that a simulation gives the same result whatever else the process simulates */
+    int flushed = 0;
+    for (int i = 0; i < c -> num_sets; i++) {
+        for (int j = 0; j < c -> assoc; j++) {
+            cache_line *line = &c -> sets[i][j];
+            if (line -> valid && ((flush_percent >= 100) || ((int)(sim_random(rng) % 100) < flush_percent))) {
+                /* An invalid line is always picked before any valid line, so the lru order can be left as is */
+                if (line -> prefetched) {
+                    c -> useless_prefetches++;
+                }
+                *dirty_lines += drop_line(c, line);
+                flushed++;
+            }
+        }
+    }
+    return flushed;
+}
+
+int tlb_lookup(tlb_entry tlb[], int num_entries, long long vpn, int asid) {
+/* tlb_lookup returns 1 if the translation for vpn is present in the TLB and inserts it, replacing an invalid or the
+ * least recently used entry, otherwise. The lru_cntr values follow the same scheme as the lines of a cache set */
+    int accessed = -1, max_lru_cntr = -1;
+    int hit = 0;
+    for (int i = 0; i < num_entries; i++) {
+        if (tlb[i].valid && (tlb[i].vpn == vpn) && (tlb[i].asid == asid)) {
+            accessed = i;
+            hit = 1;
+            break;
+        }
+    }
+    if (!hit) {
+        for (int i = 0; i < num_entries; i++) {
+            if (tlb[i].valid == 0) {
+                accessed = i;
+                break;
+            } else if (tlb[i].lru_cntr > max_lru_cntr) {
+                max_lru_cntr = tlb[i].lru_cntr;
+                accessed = i;
+            }
+        }
+        tlb[accessed].valid = 1;
+        tlb[accessed].vpn = vpn;
+        tlb[accessed].asid = asid;
+    }
+
+    short lru_cntr_accessed = tlb[accessed].lru_cntr;
+    for (int i = 0; i < num_entries; i++) {
+        if (tlb[i].lru_cntr < lru_cntr_accessed) {
+            tlb[i].lru_cntr++;
+        } else if (tlb[i].lru_cntr == lru_cntr_accessed) {
+            tlb[i].lru_cntr = 0;
+        }
+    }
+    return hit;
+}
+
+int tlb_shootdown(tlb_entry tlb[], int num_entries, int asid) {
+/* tlb_shootdown invalidates all the entries belonging to asid, or the whole TLB if asid is -1, and returns the number
+ * of entries invalidated */
+    int invalidated = 0;
+    for (int i = 0; i < num_entries; i++) {
+        if (tlb[i].valid && ((asid == -1) || (tlb[i].asid == asid))) {
+            tlb[i].valid = 0;
+            invalidated++;
+        }
+    }
+    return invalidated;
+}
+
+int parse_flush_policy(const char *name, int *flush_percent) {
+/* parse_flush_policy accepts "none", "full" or "partial:<percent>" and returns the matching flush_policy or -1 */
+    if (strcmp(name, "none") == 0) {
+        return FLUSH_NONE;
+    } else if (strcmp(name, "full") == 0) {
+        return FLUSH_FULL;
+    } else if ((sscanf(name, "partial:%d", flush_percent) == 1) && (*flush_percent >= 0) && (*flush_percent <= 100)) {
+        return FLUSH_PARTIAL;
+    }
+    return -1;
+}
+
+unsigned long long sim_random(unsigned long long *state) {
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static long long phys_pages_of(const page_map *map) {
+    return (map->policy == MAP_HUGE) ? (PHYS_PAGES >> (HUGE_PAGE_BITS - PAGE_BITS)) : PHYS_PAGES;
+}
+
+void page_map_init(page_map *map, int policy, int cache_way_bits) {
+    map->policy = policy;
+    map->page_bits = (policy == MAP_HUGE) ? HUGE_PAGE_BITS : PAGE_BITS;
+    map->num_colors = (cache_way_bits > map->page_bits) ? (1 << (cache_way_bits - map->page_bits)) : 1;
+    map->next_in_color = (long long *)calloc(map->num_colors, sizeof(long long));
+    map->pages_mapped = 0;
+    map->capacity = 1024;
+    map->entries = (page_map_entry *)calloc(map->capacity, sizeof(page_map_entry));
+    map->rng = PAGE_MAP_SEED;
+    map->frames_used = ((policy == MAP_RANDOM) || (policy == MAP_HUGE)) ?
+                       (unsigned char *)calloc(phys_pages_of(map) / 8, 1) : NULL;
+}
+
+static long long page_map_slot(page_map *map, long long vpn, int asid) {
+    unsigned long long h = ((unsigned long long)vpn ^ ((unsigned long long)asid << 40)) * 0x9E3779B97F4A7C15ULL;
+    long long slot = (long long)(h >> 20) & (map->capacity - 1);
+    while (map->entries[slot].valid && ((map->entries[slot].vpn != vpn) || (map->entries[slot].asid != asid))) {
+        slot = (slot + 1) & (map->capacity - 1);
+    }
+    return slot;
+}
+
+static long long allocate_page(page_map *map, long long vpn) {
+/* allocate_page picks the physical page backing vpn. Random frames are drawn uniformly among the frames not taken yet,
+ * drawing again when a frame is taken, from a generator with a fixed seed so that runs are reproducible. Once every
+ * frame is taken, frames are handed out again */
+    long long phys_pages = phys_pages_of(map);
+    switch (map->policy) {
+        case MAP_IDENTITY:
+            return vpn;
+        case MAP_COLOR: {
+            /* The frame has the same color as the virtual page, frames of one color are handed out in order */
+            int color = vpn & (map->num_colors - 1);
+            return (map->next_in_color[color]++ * map->num_colors + color) & (phys_pages - 1);
+        }
+        default: {
+            long long frame = (long long)(sim_random(&map->rng) & (phys_pages - 1));
+            while ((map->pages_mapped < phys_pages) && (map->frames_used[frame >> 3] & (1 << (frame & 7)))) {
+                frame = (long long)(sim_random(&map->rng) & (phys_pages - 1));
+            }
+            map->frames_used[frame >> 3] |= 1 << (frame & 7);
+            return frame;
+        }
+    }
+}
+
+long long translate(page_map *map, long long address, int asid) {
+/* translate returns the physical address of a virtual address, mapping its page on the first touch */
+    long long vpn = address >> map->page_bits;
+    long long slot = page_map_slot(map, vpn, asid);
+
+    if (!map->entries[slot].valid) {
+        /* Keep the table at most half full so that probe sequences stay short */
+        if (2*(map->pages_mapped + 1) > map->capacity) {
+            page_map_entry *old = map->entries;
+            long long old_capacity = map->capacity;
+            map->capacity *= 2;
+            map->entries = (page_map_entry *)calloc(map->capacity, sizeof(page_map_entry));
+            for (long long i = 0; i < old_capacity; i++) {
+                if (old[i].valid) {
+                    map->entries[page_map_slot(map, old[i].vpn, old[i].asid)] = old[i];
+                }
+            }
+            free(old);
+            slot = page_map_slot(map, vpn, asid);
+        }
+        map->entries[slot].valid = 1;
+        map->entries[slot].vpn = vpn;
+        map->entries[slot].asid = asid;
+        map->entries[slot].ppn = allocate_page(map, vpn);
+        map->pages_mapped++;
+    }
+    return (map->entries[slot].ppn << map->page_bits) | (address & ((1LL << map->page_bits) - 1));
+}
+
+int parse_map_policy(const char *name) {
+    if (strcmp(name, "identity") == 0) {
+        return MAP_IDENTITY;
+    } else if (strcmp(name, "random") == 0) {
+        return MAP_RANDOM;
+    } else if (strcmp(name, "color") == 0) {
+        return MAP_COLOR;
+    } else if (strcmp(name, "huge") == 0) {
+        return MAP_HUGE;
+    }
+    return -1;
+}
+
+int parse_index_function(const char *name) {
+    if (strcmp(name, "modulo") == 0) {
+        return INDEX_MODULO;
+    } else if (strcmp(name, "xor") == 0) {
+        return INDEX_XOR;
+    } else if (strcmp(name, "prime") == 0) {
+        return INDEX_PRIME;
+    } else if (strcmp(name, "skew") == 0) {
+        return INDEX_SKEW;
+    }
+    return -1;
+}
+
+int parse_geometry(const char *spec, int *s, int *assoc, int *b) {
+/* parse_geometry reads a cache geometry given as s:E:b and returns 0 if it is malformed */
+    return (sscanf(spec, "%d:%d:%d", s, assoc, b) == 3) && (*s >= 0) && (*assoc > 0) && (*b >= 0);
+}
+
+void print_level(cache *c, FILE *out) {
+    fprintf(out, "%s hits:%lld misses:%lld evictions:%lld writebacks:%lld\n", c -> name, c -> hits, c -> misses,
+            c -> evictions, c -> writebacks);
+}
+
+int parse_nt_policy(const char *name) {
+    if (strcmp(name, "bypass") == 0) {
+        return NT_BYPASS;
+    } else if (strcmp(name, "lowpri") == 0) {
+        return NT_LOW_PRIORITY;
+    }
+    return -1;
+}
+
+static double seconds_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+unsigned long long profile_ticks(void) {
+/* profile_ticks reads the time stamp counter where there is one and the monotonic clock in nanoseconds elsewhere */
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+void profile_start(profile *p) {
+    memset(p, 0, sizeof(*p));
+    /* Time empty phases to find out what timing costs by itself */
+    sim_profile = p;
+    for (int i = 0; i < 1024 * PROFILE_SAMPLE; i++) {
+        profile_end(PROFILE_OUTPUT, profile_begin(PROFILE_OUTPUT));
+    }
+    p -> overhead = p -> ticks[PROFILE_OUTPUT] / p -> sampled[PROFILE_OUTPUT];
+    memset(p -> calls, 0, sizeof(p -> calls));
+    memset(p -> sampled, 0, sizeof(p -> sampled));
+    memset(p -> ticks, 0, sizeof(p -> ticks));
+    p -> start_seconds = seconds_now();
+    p -> start_ticks = profile_ticks();
+}
+
+void profile_report(profile *p, long long accesses, FILE *out) {
+    static const char *names[PROFILE_PHASES] = { "decode", "simulate", "cache_lookup", "update_lru_cntr", "output" };
+    double seconds = seconds_now() - p -> start_seconds;
+    unsigned long long ticks = profile_ticks() - p -> start_ticks;
+    double seconds_per_tick = ticks ? seconds / ticks : 0;
+
+    for (int i = 0; i < PROFILE_PHASES; i++) {
+        /* The sampled calls stand for all the calls of the phase */
+        unsigned long long sampled_ticks = p -> ticks[i] - p -> overhead * p -> sampled[i];
+        if (p -> ticks[i] < p -> overhead * p -> sampled[i]) {
+            sampled_ticks = 0;
+        }
+        double phase_seconds = p -> sampled[i] ?
+                               (double)sampled_ticks * seconds_per_tick * p -> calls[i] / p -> sampled[i] : 0;
+        fprintf(out, "profile phase:%s calls:%llu seconds:%.6f share:%.1f%% ns_per_call:%.2f\n", names[i],
+                p -> calls[i], phase_seconds, seconds > 0 ? 100 * phase_seconds / seconds : 0.0,
+                p -> calls[i] ? phase_seconds * 1e9 / p -> calls[i] : 0.0);
+    }
+    fprintf(out, "profile total_seconds:%.6f accesses:%lld ns_per_access:%.2f\n", seconds, accesses,
+            accesses ? seconds * 1e9 / accesses : 0.0);
+}
+
+void sim_print_options(void) {
+/* sim_print_options prints the help of the options in SIM_OPTIONS */
+    printf("  -v         Optional verbose flag, prints the outcome of every access.\n");
+    printf("  -s <num>   Number of set index bits\n");
+    printf("  -E <num>   Number of lines per set.\n");
+    printf("  -b <num>   Number of block offset bits.\n");
+    printf("  -a         Tag cache lines and TLB entries with the address-space ID of the record.\n");
+    printf("  -F <pol>   Cache flush on a context switch : none (default), full or partial:<percent>.\n");
+    printf("  -T <num>   Simulate a fully associative data TLB with <num> entries.\n");
+    printf("  -P <pol>   Translate addresses before indexing the cache : identity, random, color (page coloring)\n");
+    printf("             or huge (random 2MB pages). By default the cache is indexed with virtual addresses.\n");
+    printf("  -I <fn>    Set index function : modulo (default), xor (XOR-folded), prime (prime modulo)\n");
+    printf("             or skew (skewed-associative, one hash per way).\n");
+    printf("  -S <num>   Number of sets, need not be a power of two. Replaces -s.\n");
+    printf("  -B <num>   Number of sector offset bits, a line of 2^b bytes is fetched in sectors of 2^B bytes.\n");
+    printf("  -z         Honor the access size, accesses straddling lines are split into one lookup per line.\n");
+    printf("  -i <s:E:b> Simulate instruction fetches in a separate L1 instruction cache of this geometry.\n");
+    printf("  -L <s:E:b> Add a unified L2 cache of this geometry behind the L1 caches.\n");
+    printf("  -n <pol>   Non-temporal stores ('N' records) : bypass (default) or lowpri (insert as LRU line).\n");
+    printf("  -c         Collapse consecutive accesses to the same line into one lookup. Ignored with -v.\n");
+}
@@ -0,0 +1,260 @@
+/* cachesim.h - The simulated memory hierarchy of csim: the caches, the TLB, the page allocator and their statistics,
+ * fed one trace record at a time. The simulated features and their options are described in csim.c; tools which
+ * produce their accesses themselves instead of reading a trace drive the simulator through this interface. */
+
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include "trace.h"
+#include <stdio.h>
+
+#define PAGE_BITS 12
+/* The sector state of a line is kept in 64-bit masks */
+#define MAX_SECTORS 64
+/* The sets of a cache are counted in an int, and the ways of a set ordered by short lru counters */
+#define MAX_SET_BITS 30
+#define MAX_ASSOC 32767
+#define HUGE_PAGE_BITS 21
+/* Size of the simulated physical memory in pages, must be a power of two */
+#define PHYS_PAGES (1LL << 24)
+/* The seed of the random frames of -P random and huge, fixed so that runs are reproducible */
+#define PAGE_MAP_SEED 0x5bd1e995ULL
+/* The seed of the lines picked by the partial flushes of -F, fixed for the same reason */
+#define FLUSH_SEED 0x2545F4914F6CDD1DULL
+
+typedef struct {
+    long long tag;
+    int asid;
+    short valid;
+    short lru_cntr;
+    /* Set when the line was filled by a software prefetch and has not been accessed since */
+    short prefetched;
+    /* One bit per sector of the line, without -B the line is a single sector */
+    unsigned long long sector_valid;
+    unsigned long long sector_dirty;
+    /* Time of the last access, only used by the skewed cache where the ways of a set do not form a set of their own */
+    long long stamp;
+} cache_line;
+
+/* A fully associative data TLB with LRU replacement, only simulated when requested with -T */
+typedef struct {
+    long long vpn;
+    int asid;
+    short valid;
+    short lru_cntr;
+} tlb_entry;
+
+/* What happens to the cache contents when the trace switches to another address space */
+enum flush_policy { FLUSH_NONE, FLUSH_FULL, FLUSH_PARTIAL };
+
+/* The function mapping a block address to a set */
+enum index_function { INDEX_MODULO, INDEX_XOR, INDEX_PRIME, INDEX_SKEW };
+
+/* How the simulated OS picks a physical page for a virtual page touched for the first time */
+enum map_policy { MAP_NONE, MAP_IDENTITY, MAP_RANDOM, MAP_COLOR, MAP_HUGE };
+
+typedef struct {
+    long long vpn;
+    long long ppn;
+    int asid;
+    short valid;
+} page_map_entry;
+
+/* The page table of every address space, kept as a single open addressing hash table on (asid, vpn) */
+typedef struct {
+    int policy;
+    int page_bits;
+    int num_colors;
+    long long *next_in_color;
+    long long pages_mapped;
+    long long capacity;
+    page_map_entry *entries;
+    /* The random frames are drawn by a generator of state rng, one bit per physical page telling whether it is taken */
+    unsigned long long rng;
+    unsigned char *frames_used;
+} page_map;
+
+/* One level of the simulated hierarchy along with its statistics */
+typedef struct {
+    const char *name;
+    int s, b, assoc, num_sets;
+    int index_fn;
+    /* The number of sets the index function actually uses, less than num_sets for prime modulo indexing */
+    int index_sets;
+    /* The plain tag drops the set index bits, which is only possible when the index is the low bits of the block */
+    int full_block_tag;
+    int sector_bits;
+    cache_line **sets;
+    long long access_count;
+    long long hits, misses, evictions;
+    long long tag_misses, sector_misses, writebacks;
+    long long sectors_fetched;
+    /* Effect of the trace-embedded hints: prefetches that brought a line in, prefetched lines later used by a demand
+     * access or evicted unused, and non-temporal stores that bypassed the cache */
+    long long prefetch_fills, useful_prefetches, useless_prefetches, bypasses;
+} cache;
+
+enum access_result { ACCESS_HIT, ACCESS_SECTOR_MISS, ACCESS_MISS, ACCESS_MISS_EVICTION, ACCESS_BYPASS };
+
+/* Flags describing an access to cache_access */
+#define ACCESS_WRITE 0x1
+/* A software prefetch, which fills the line without being counted as a hit or a miss */
+#define ACCESS_PREFETCH 0x2
+/* A non-temporal store which only updates the line if it is already present */
+#define ACCESS_NO_ALLOCATE 0x4
+/* A non-temporal store which is allocated as the least recently used line of its set, so it is evicted first */
+#define ACCESS_LOW_PRIORITY 0x8
+
+/* How non-temporal stores are simulated */
+enum nt_policy { NT_BYPASS, NT_LOW_PRIORITY };
+
+/* A dirty line evicted by an access, which has to be written to the next level */
+typedef struct {
+    long long address;
+    int asid;
+    int valid;
+} writeback;
+
+/* The whole simulated system: the options, the cache hierarchy, the TLB, the page allocator and the statistics which
+ * are not kept by the caches themselves */
+typedef struct {
+    int verbose, asid_tags, honor_size, sectored;
+    int flush_policy, flush_percent, nt_policy;
+    /* The state of the generator the partial flushes draw from, each simulator having its own */
+    unsigned long long flush_rng;
+    int icache, l2cache;
+    cache l1d, l1i, l2;
+    int tlb_entries;
+    tlb_entry *tlb;
+    int map_policy;
+    page_map pmap;
+    /* The address space the records without an ASID belong to */
+    int cur_asid;
+    long long context_switches, lines_flushed, flush_writebacks, tlb_hits, tlb_misses, tlb_shootdowns;
+    long long split_accesses, line_lookups;
+    long long hint_records, clflushes, clflush_writebacks;
+    /* Runs and groups read from the trace and their accesses simulated without looking them up one by one */
+    long long runs, fast_path_accesses;
+    /* The same-line coalescing filter and the accesses it holds back: pending_count accesses to the line of
+     * pending, pending_modifies of them 'M' records */
+    int coalesce;
+    trace_record pending;
+    int pending_asid, pending_write;
+    long long pending_count, pending_modifies, coalesced_accesses;
+} simulator;
+
+/* The options of a simulation as given on the command line, see usage in csim.c */
+typedef struct {
+    /* Geometry of the L1 data cache, -1 until given. num_sets is only set by -S and sector_bits by -B */
+    int s, assoc, b, num_sets, sector_bits;
+    int index_fn;
+    /* Optional levels: the L1 instruction cache and the unified L2, each given as s:E:b */
+    int icache, i_s, i_E, i_b;
+    int l2cache, l2_s, l2_E, l2_b;
+    int verbose, asid_tags, honor_size, coalesce;
+    int flush_policy, flush_percent, nt_policy, tlb_entries, map_policy;
+} sim_config;
+
+/* The getopt letters of the simulation options, tools add their own letters to it */
+#define SIM_OPTIONS "s:E:b:vaF:T:P:I:S:B:zi:L:n:c"
+
+void sim_config_init(sim_config *cfg);
+/* sim_parse_option applies the option letter opt of SIM_OPTIONS and returns 0 if opt is not a simulation option and
+ * -1 if its argument is malformed */
+int sim_parse_option(sim_config *cfg, int opt, const char *arg);
+/* sim_config_complete returns 0 unless the geometry of the L1 data cache was given */
+int sim_config_complete(const sim_config *cfg);
+/* sim_parse_args applies the n words of args, options of SIM_OPTIONS and their arguments, to a fresh configuration and
+ * returns what is wrong with them, or a nullptr */
+const char *sim_parse_args(sim_config *cfg, char *args[], int n);
+/* sim_config_key writes a text which identifies the configuration into buf and returns 0 if it does not fit */
+int sim_config_key(const sim_config *cfg, char *buf, int size);
+/* sim_config_check returns why the simulator described by a complete cfg cannot be built, a nullptr if it can. It
+ * allocates nothing, so that a configuration can be rejected before any simulator is built */
+const char *sim_config_check(const sim_config *cfg);
+/* simulator_init builds an empty system from the options and returns 0 if they describe an impossible cache */
+int simulator_init(simulator *sim, const sim_config *cfg);
+void simulator_free(simulator *sim);
+void sim_print_options(void);
+void simulate_record(simulator *sim, const trace_record *rec);
+void simulate_group(simulator *sim, const trace_record members[], int p, long long count);
+void simulate_records(simulator *sim, const trace_record recs[], long long n);
+/* simulate_batch simulates n records which hold no group on the simulator sim, and serves as the sink of tracerec
+ * (tracerec.h) to simulate the accesses of a program as they are recorded */
+void simulate_batch(void *sim, const trace_record recs[], int n);
+void simulate_access(simulator *sim, char access_type, long long address, int size, int record_asid);
+int record_asid_of(simulator *sim, const trace_record *rec);
+int coalesce_access(simulator *sim, const trace_record *rec);
+void coalesce_flush(simulator *sim);
+void print_statistics(simulator *sim, FILE *out);
+void cache_init(cache *c, const char *name, int s, int num_sets, int assoc, int b, int sector_bits, int index_fn);
+int cache_access(cache *c, long long address, long long last_byte, int asid, int flags, int *set_index,
+                 writeback *victim);
+cache_line *cache_find(cache *c, long long address, int asid, int *set_index);
+int cache_invalidate(cache *c, long long address, int asid);
+void demote_line(cache *c, int set_index, cache_line *line);
+cache_line *cache_lookup(cache_line set[], int assoc, long long tag, int asid, cache_line **hit_line);
+cache_line *skew_lookup(cache_line *cache[], int assoc, int num_sets, int s, long long block, int asid, long long now,
+                        cache_line **hit_line);
+int set_index_of(int index_fn, long long block, int s, int num_sets, int way);
+void update_lru_cntr(cache_line set[], int assoc, short lru_cntr_accessed);
+int flush_cache(cache *c, int flush_percent, unsigned long long *rng, long long *dirty_lines);
+int tlb_lookup(tlb_entry tlb[], int num_entries, long long vpn, int asid);
+int tlb_shootdown(tlb_entry tlb[], int num_entries, int asid);
+int parse_flush_policy(const char *name, int *flush_percent);
+/* sim_random returns the next number of the splitmix64 generator of the given state */
+unsigned long long sim_random(unsigned long long *state);
+void page_map_init(page_map *map, int policy, int cache_way_bits);
+long long translate(page_map *map, long long address, int asid);
+int parse_map_policy(const char *name);
+int parse_index_function(const char *name);
+int parse_geometry(const char *spec, int *s, int *assoc, int *b);
+int parse_nt_policy(const char *name);
+void print_level(cache *c, FILE *out);
+
+/* The phases of the simulation timed by the profiler of csim --profile. The lookups include the updates of the lru
+ * order they make */
+enum profile_phase { PROFILE_DECODE, PROFILE_SIMULATE, PROFILE_LOOKUP, PROFILE_LRU, PROFILE_OUTPUT, PROFILE_PHASES };
+
+/* Only one call in PROFILE_SAMPLE of every phase is timed, must be a power of two */
+#define PROFILE_SAMPLE 16
+
+typedef struct {
+    unsigned long long calls[PROFILE_PHASES], sampled[PROFILE_PHASES], ticks[PROFILE_PHASES];
+    /* The cost of timing an empty phase, taken off every sample */
+    unsigned long long overhead;
+    unsigned long long start_ticks;
+    double start_seconds;
+} profile;
+
+/* The profile being collected, a nullptr unless profiling */
+extern profile *sim_profile;
+
+unsigned long long profile_ticks(void);
+/* profile_start clears p and makes it the profile being collected */
+void profile_start(profile *p);
+/* profile_report prints the time spent in every phase, estimated from the samples, and the cost per access */
+void profile_report(profile *p, long long accesses, FILE *out);
+
+/* profile_begin returns the time a sampled call of phase starts at, or 0 if the call is not sampled. The first calls
+ * are always sampled, so that rare phases are timed too. Past them every phase is sampled on different calls, so that
+ * timing a lookup does not add to the time of the record enclosing it */
+static inline unsigned long long profile_begin(int phase) {
+    if (sim_profile == NULL) {
+        return 0;
+    }
+    unsigned long long call = sim_profile -> calls[phase]++;
+    if ((call >= PROFILE_SAMPLE) && (((call + 5*phase) & (PROFILE_SAMPLE - 1)) != 0)) {
+        return 0;
+    }
+    return profile_ticks();
+}
+
+static inline void profile_end(int phase, unsigned long long start) {
+    if (start) {
+        sim_profile -> ticks[phase] += profile_ticks() - start;
+        sim_profile -> sampled[phase]++;
+    }
+}
+
+#endif
@@ -1,188 +1,243 @@
 /* csim.c - A cache simulator which outputs the hits, misses and evictions for a given sequence 
  * of memory references.
  * Required inputs : number of bits in the set index(s), associativity(E), number of bits in
- * the offset(b) and a trace file containing memory accesses */
+ * the offset(b) and a trace file containing memory accesses
+ *
+ * Traces from several processes can be interleaved. A data record may carry the address-space ID of the process
+ * that issued it as a third field (" L 7ff000a0,8,2"), and the following records control context switches:
+ *   X <asid>   switch to address space <asid>; later records without an explicit ASID belong to it
+ *   K <asid>   TLB shootdown, invalidates every TLB entry belonging to <asid>
+ *
+ * Besides the I, L, S and M records of valgrind, the trace may carry the hints issued by the program:
+ *   N <addr>,<size>   non-temporal (streaming) store, bypasses the caches or is inserted with low priority (-n)
+ *   P <addr>,<size>   software prefetch, fills the line without counting as a demand access
+ *   F <addr>,<size>   clflush, invalidates the line in every level and writes it back if it is dirty
+ *
+ * Caches are physically indexed, so the virtual addresses of the trace can be translated by a simulated OS page
+ * allocator (-P) before the set index and tag are computed.
+ *
+ * The set index is the low bits of the block address by default. -I selects a hashed index function instead and -S
+ * allows set counts which are not a power of two. Whenever the index is not simply the low bits of the block address,
+ * the tag holds the whole block address since the set index can no longer be recovered from the remaining bits.
+ *
+ * With -B the lines are sectored: a tag covers 2^b bytes but data is fetched in sectors of 2^B bytes. A miss to a
+ * resident tag (a sector miss) fetches only the missing sector and does not evict anything.
+ *
+ * The cache given by -s, -E and -b is the L1 data cache. Instruction fetches ('I' records) are ignored unless an L1
+ * instruction cache is added with -i, and -L adds a unified L2 behind both L1 caches. The L2 is neither inclusive nor
+ * exclusive: it is filled by the L1 misses and absorbs the dirty lines evicted from the L1 data cache.
+ *
+ * The trace may also be a binary trace (see trace.h), whose records can describe whole strided runs of accesses, or
+ * groups of interleaved runs. When nothing in the configuration needs to see the individual accesses, a group of
+ * loads and stores is simulated arithmetically. For as many repetitions as every member stays within its current line,
+ * only the first repetition is looked up. If the lines of all the members are still cached after it, the group cannot
+ * conflict with itself and the remaining repetitions are hits which leave the lru order as the first one left it.
+ *
+ * The same reasoning makes the optional coalescing filter (-c) exact for any trace. Consecutive accesses to the same
+ * line (the same sector of a sectored line) are collapsed into one lookup, with the write flag set if any of them
+ * writes, followed by a hit for every other access. Records which are not plain loads, stores, modifies or
+ * instruction fetches, and accesses straddling sectors, pass the filter unchanged.
+ *
+ * The trace may also come from other tools, DineroIV, ChampSim or a raw address stream (-f, see trace.h).
+ *
+ * The trace is read front to back in large blocks and never seeked, so -t - reads it from a pipe as the tracer produces
+ * it, for instance valgrind --tool=lackey --trace-mem=yes --log-fd=1 ./prog | csim -s 5 -E 1 -b 5 -t - -p 10, with
+ * the progress reported on standard error every 10 seconds.
+ *
+ * --profile reports where the time goes: the decoding of the trace, the simulation of the records, and within it the
+ * lookups, the updates of the lru order and the output of -v. One call in PROFILE_SAMPLE of each is timed with the
+ * time stamp counter, and the cost of timing is measured once and taken off every sample.
+ *
+ * --cache <dir> keeps the results in a persistent cache shared by any number of runs (see resultcache.h): a trace
+ * simulated before on the same configuration is answered from the cache, without being read.
+ *
+ * Build with : gcc -g -Wall -Werror -std=c99 -m64 -o csim csim.c cachesim.c trace.c resultcache.c cachelab.c */
 
 #include "cachelab.h"
+#include "cachesim.h"
+#include "trace.h"
+#include "resultcache.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <getopt.h>
-#include <assert.h>
+#include <string.h>
+#include <time.h>
 
-typedef struct {
-    long long tag;
-    short valid;
-    short lru_cntr;
-} cache_line;
+/* Number of records read between two looks at the clock for the progress report */
+#define PROGRESS_CHECK (1 << 16)
+/* The value getopt_long returns for --profile, outside of the letters */
+#define PROFILE_OPTION 256
+#define CACHE_OPTION 257
 
-cache_line *cache_lookup(cache_line set[], int assoc, long long tag);
-void update_lru_cntr(cache_line set[], int assoc, short lru_cntr_accessed);
+int read_record(trace_reader *r, trace_record *rec);
+void print_progress(simulator *sim, trace_reader *r, long long records, double seconds);
 void usage(char *argv[]);
 
 int main(int argc, char *argv[]) {
     extern char* optarg;
-    int sflag = 0, Eflag = 0, bflag = 0, tflag = 0, err_flag = 0;
-    char *sname, *Ename, *trace_file, *bname;
-    char c;
+    int tflag = 0, err_flag = 0, progress = 0, format = TRACE_TEXT, profiling = 0;
+    char *trace_file = NULL, *cache_dir = NULL;
+    int c;
+    sim_config cfg;
+    simulator sim;
+    profile prof;
+    static struct option long_options[] = {
+        { "profile", no_argument, NULL, PROFILE_OPTION },
+        { "cache", required_argument, NULL, CACHE_OPTION },
+        { NULL, 0, NULL, 0 }
+    };
+    sim_config_init(&cfg);
 
 /* Use getopt to read the commandline arguments */
-    while((c = getopt(argc, argv, "s:E:b:t:")) != -1) {
+    while((c = getopt_long(argc, argv, SIM_OPTIONS "t:f:p:h", long_options, NULL)) != -1) {
         switch(c) {
-            case 's':
-                sflag = 1;
-                sname = optarg;
+            case PROFILE_OPTION:
+                profiling = 1;
                 break;
-            case 'E':
-                Eflag = 1;
-                Ename = optarg;
-                break;
-            case 'b':
-                bflag = 1;
-                bname = optarg;
+            case CACHE_OPTION:
+                cache_dir = optarg;
                 break;
             case 't':
                 tflag = 1;
                 trace_file = optarg;
                 break;
-            case '?':
-                err_flag = 1;
+            case 'f':
+                format = trace_parse_format(optarg);
+                if (format < 0) {
+                    err_flag = 1;
+                }
+                break;
+            case 'p':
+                progress = atoi(optarg);
+                if (progress <= 0) {
+                    err_flag = 1;
+                }
+                break;
+            case 'h':
+                usage(argv);
+                return 0;
+            default:
+                if (sim_parse_option(&cfg, c, optarg) <= 0) {
+                    err_flag = 1;
+                }
                 break;
           }
     }
 
-    if ((sflag == 0) || (Eflag == 0) || (bflag == 0) || (tflag == 0)) {
+    if (!sim_config_complete(&cfg) || (tflag == 0)) {
         fprintf(stderr, "required parameter missing, check usage\n");
         usage(argv);
         return -1;
     }
     
     if (err_flag) {
-        fprintf(stderr, "unknown parameter encountered, check usage\n");
+        fprintf(stderr, "unknown or malformed parameter encountered, check usage\n");
         usage(argv);
         return -2;
     }
 
-    int s, b, num_sets, assoc;
-    s = atoi(sname);
-    b = atoi(bname);
-    num_sets = (1 << s);
-    assoc = atoi(Ename);
-    const int INDEX_MASK = (1 << s) - 1;
-
-    cache_line *cache[num_sets];
+    const char *problem = sim_config_check(&cfg);
+    if (problem != NULL) {
+        fprintf(stderr, "%s\n", problem);
+        return -2;
+    }
 
-    for (int i = 0; i < num_sets; i++) {
-        cache[i] = (cache_line *)malloc(assoc*sizeof(cache_line));
+    /* A profile needs the simulation to run. The result is looked up before the hierarchy is allocated, which a hit
+     * never needs */
+    char key[RESULT_MAX_KEY];
+    int cacheable = (cache_dir != NULL) && !profiling && result_key(trace_file, format, &cfg, key, sizeof(key));
+    long long counts[3];
+    if (cacheable && result_lookup(cache_dir, key, stdout, counts)) {
+        printSummary((int)counts[0], (int)counts[1], (int)counts[2]);
+        return 0;
     }
 
-    for (int i = 0; i < num_sets; i++) {
-        for (int j = 0; j < assoc; j++) {
-            cache[i][j].valid = 0;
-            /* Initializing with j ensures that all the lru_cntr values are distinct as is the case with normal
-             * operation */
-            cache[i][j].lru_cntr = j; 
-        }
+    if (!simulator_init(&sim, &cfg)) {
+        return -2;
     }
 
-    FILE *tracefp;
-    tracefp = fopen(trace_file, "r");
-    char access_type;
-    long long address; // address specifies a 64-bit hex value
-    int hits = 0, misses = 0, evictions = 0;
+    trace_reader *tracefp;
+    tracefp = trace_open_as(trace_file, format);
+    if (tracefp == NULL) {
+        fprintf(stderr, "could not open trace file %s\n", trace_file);
+        return -3;
+    }
+    trace_record rec, members[TRACE_MAX_GROUP];
+    long long records = 0;
+    time_t start = time(NULL), next_report = start + progress;
+    if (profiling) {
+        profile_start(&prof);
+    }
 
-    while(fscanf(tracefp, " %c %llx %*c %*d", &access_type, &address) == 2) {
-        if (access_type == 'I') {
-            /* Ignore instruction references since we are only interested in data references */
-            continue;
+    while (read_record(tracefp, &rec)) {
+        if (progress && ((++records % PROGRESS_CHECK) == 0) && (time(NULL) >= next_report)) {
+            print_progress(&sim, tracefp, records, difftime(time(NULL), start));
+            next_report = time(NULL) + progress;
         }
-
-        int set_index;
-        long long tag;
-        cache_line *line_to_replace;
-        
-        set_index = (address >> b) & INDEX_MASK;
-        tag = address >> (s+b);
-        printf("%c, %llx, set = %d ", access_type, address, set_index);
-
-        line_to_replace = cache_lookup(cache[set_index], assoc, tag);
-        if (line_to_replace == NULL) {
-            hits++;
-            printf("hit\n");
-        } else {
-            misses++;
-            printf("miss %d ",misses);
-            if (line_to_replace -> valid) {
-                evictions++;
-                printf("eviction");
-            } else {
-                line_to_replace -> valid = 1;
+        if (rec.type == 'R') {
+            unsigned long long decode_start = profile_begin(PROFILE_DECODE);
+            int ok = trace_read_group(tracefp, &rec, members);
+            profile_end(PROFILE_DECODE, decode_start);
+            if (!ok) {
+                fprintf(stderr, "malformed group in trace file %s\n", trace_file);
+                return -3;
             }
-            printf("\n");
-
-            line_to_replace -> tag = tag;
-        }
-        
-        /* An 'M' or modify type of access reads a value and writes to the same location. So, irrespective of the result
-         * of the read, the write is always a hit */
-        if (access_type == 'M') {
-            hits++;
+            unsigned long long simulate_start = profile_begin(PROFILE_SIMULATE);
+            simulate_group(&sim, members, rec.size, rec.count);
+            profile_end(PROFILE_SIMULATE, simulate_start);
+        } else {
+            unsigned long long simulate_start = profile_begin(PROFILE_SIMULATE);
+            simulate_record(&sim, &rec);
+            profile_end(PROFILE_SIMULATE, simulate_start);
         }
     }
-
-    printSummary(hits, misses, evictions);
-    return 0;
-}
-cache_line *cache_lookup(cache_line set[], int assoc, long long tag) {
-/* cache_lookup searches all the lines in the set for a matching tag and returns the address where the incoming
- * block is to placed in case of a cache miss or a nullptr if it is a hit */
-
-    /* Check if the required data is already present in the cache */
-    for (int i = 0; i < assoc; i++) {
-        if (set[i].valid && (set[i].tag == tag)) {
-            update_lru_cntr(set, assoc, set[i].lru_cntr); 
-            return NULL;
-        }
+    if (tracefp -> malformed) {
+        fprintf(stderr, "malformed record in trace file %s\n", trace_file);
+        return -3;
     }
-
-    /* If the data is not present, we need to find a slot for the incoming data */
-    short max_lru_cntr = -1;
-    cache_line *lru_line;
-    for (int i = 0; i < assoc; i++) {
-        if (set[i].valid == 0) {
-            /* If an empty slot is found, no line needs to be evicted */
-            update_lru_cntr(set, assoc, set[i].lru_cntr); 
-            return &set[i];
-        } else if (set[i].lru_cntr > max_lru_cntr) {
-            /* If the set is full, evict the least recently used line */
-            max_lru_cntr = set[i].lru_cntr;
-            lru_line = &set[i];
-        }
+    coalesce_flush(&sim);
+    trace_close(tracefp);
+
+    unsigned long long output_start = profile_begin(PROFILE_OUTPUT);
+    print_statistics(&sim, stdout);
+    printSummary((int)sim.l1d.hits, (int)sim.l1d.misses, (int)sim.l1d.evictions);
+    profile_end(PROFILE_OUTPUT, output_start);
+    if (cacheable && !result_store(cache_dir, key, &sim)) {
+        fprintf(stderr, "could not store the result in %s\n", cache_dir);
     }
+    if (profiling) {
+        profile_report(&prof, sim.l1d.hits + sim.l1d.misses, stderr);
+    }
+    return 0;
+}
 
-    /* The lru line must necessarily have a lru_cntr value of assoc-1 */
-    assert(max_lru_cntr == assoc-1);
-    update_lru_cntr(set, assoc, assoc-1);
-    return lru_line;
+int read_record(trace_reader *r, trace_record *rec) {
+/* read_record is trace_read, timed as the decoding phase of the profile */
+    unsigned long long start = profile_begin(PROFILE_DECODE);
+    int ok = trace_read(r, rec);
+    profile_end(PROFILE_DECODE, start);
+    return ok;
 }
 
-void update_lru_cntr(cache_line set[], int assoc, short lru_cntr_accessed) {
-    /* All the lines in the set with lru_cntr values less than that of the accessed block must be incremented and the
-     * accessed block must have a lru_cntr value of 0 */
-    for (int i = 0; i < assoc; i++) {
-        if (set[i].lru_cntr < lru_cntr_accessed) {
-            set[i].lru_cntr++;
-        } else if (set[i].lru_cntr == lru_cntr_accessed) {
-            set[i].lru_cntr = 0;
-        }
-    }
+void print_progress(simulator *sim, trace_reader *r, long long records, double seconds) {
+/* print_progress reports on standard error how far the simulation of a trace which is still being read has come */
+    cache *l1d = &sim -> l1d;
+    long long accesses = l1d -> hits + l1d -> misses;
+    fprintf(stderr, "[%.0fs] records:%lld bytes:%lld accesses:%lld hits:%lld misses:%lld evictions:%lld "
+            "miss_rate:%.4f accesses/s:%.0f\n", seconds, records, r -> bytes_read, accesses, l1d -> hits, l1d -> misses,
+            l1d -> evictions, accesses ? (double)l1d -> misses / accesses : 0.0, (seconds > 0) ? accesses / seconds : 0.0);
 }
 
 void usage(char *argv[]) {
-    printf("%s -s <num> -E <num> -b <num> -t <file>\n", argv[0]);
+    printf("%s [-hv] -s <num> -E <num> -b <num> -t <file> [-a] [-F <pol>] [-T <num>] [-P <pol>] [-I <fn>] [-S <num>] [-B <num>] [-z] [-i <s:E:b>] [-L <s:E:b>] [-n <pol>] [-c] [-f <fmt>] [-p <sec>] [--profile] [--cache <dir>]\n", argv[0]);
     printf("\nOptions:\n");
-    printf("  -s <num>   Number of set index bits\n");
-    printf("  -E <num>   Number of lines per set.\n");
-    printf("  -b <num>   Number of block offset bits.\n");
-    printf("  -t <file>  Trace file.\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -t <file>  Trace file, - for standard input.\n");
+    printf("  -f <fmt>   Format of the trace : text or binary (detected, default), din (DineroIV), champsim or raw\n");
+    printf("             (little-endian 64-bit load addresses).\n");
+    printf("  -p <sec>   Report the progress on standard error every <sec> seconds.\n");
+    printf("  --profile  Time the decoding, the lookups, the lru updates and the output, and report on standard error.\n");
+    printf("  --cache <dir> Look the result up in the cache <dir> before simulating, and add it once simulated.\n");
+    sim_print_options();
     printf("\nExample : %s -s 4 -E 1 -b 4 -t traces/yi.trace\n", argv[0]);       
 }
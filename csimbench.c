@@ -0,0 +1,311 @@
+/* csimbench.c - Measures the speed of csim over a matrix of workloads, trace formats, geometries and index functions.
+ * Required inputs : none, every dimension of the matrix has a default
+ *
+ * The workloads are generated once with tracesynth and converted to every requested format, text, binary or zip (the
+ * binary format compressed by tracezip). csim is then run on each combination, as its own process so that its peak
+ * resident set size can be read from the rusage of the child, and the fastest of -r runs is reported as a line of
+ * key:value pairs:
+ *   bench workload:zipf format:binary s:10 E:4 b:6 index:modulo coalesce:0 accesses:1000000 seconds:0.052
+ *         accesses_per_s:19230769 ns_per_access:52.0 peak_rss_kb:2104 misses:123456
+ * all on one line, so that runs on different commits can be compared with a diff or a script. Geometries whose
+ * cache lines alone would take more than -m MB are skipped.
+ *
+ * Build with : gcc -g -Wall -Werror -std=c99 -m64 -O2 -o csimbench csimbench.c */
+
+#define _DEFAULT_SOURCE
+#include "cachesim.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define MAX_LIST 32
+#define MAX_OUTPUT 65536
+
+/* A comma-separated list given on the command line */
+typedef struct {
+    int n;
+    char *items[MAX_LIST];
+} list;
+
+/* The outcome of one run of csim */
+typedef struct {
+    int ok;
+    double seconds;
+    long peak_rss_kb;
+    long long hits, misses;
+} run_result;
+
+int split_list(char *spec, list *l);
+int run_tool(char *const args[], int quiet, char *output, int output_size, run_result *result);
+void usage(char *argv[]);
+
+int main(int argc, char *argv[]) {
+    extern char* optarg;
+    char *csim = "./csim", *synth = "./tracesynth", *zip = "./tracezip", *dir = "/tmp";
+    char workloads_spec[] = "seq,random,zipf,submit", formats_spec[] = "binary,text";
+    char assoc_spec[] = "1,4,16,64", sets_spec[] = "5,10,15,20", index_spec[] = "modulo";
+    list workloads, formats, assocs, sets, index_fns;
+    long long accesses = 1000000;
+    int b = 6, repeats = 3, coalesce = 0, max_mb = 1024, c, err_flag = 0;
+
+    split_list(workloads_spec, &workloads);
+    split_list(formats_spec, &formats);
+    split_list(assoc_spec, &assocs);
+    split_list(sets_spec, &sets);
+    split_list(index_spec, &index_fns);
+
+    while((c = getopt(argc, argv, "C:G:Z:d:w:f:E:s:b:I:n:r:m:ch")) != -1) {
+        switch(c) {
+            case 'C':
+                csim = optarg;
+                break;
+            case 'G':
+                synth = optarg;
+                break;
+            case 'Z':
+                zip = optarg;
+                break;
+            case 'd':
+                dir = optarg;
+                break;
+            case 'w':
+                err_flag |= !split_list(optarg, &workloads);
+                break;
+            case 'f':
+                err_flag |= !split_list(optarg, &formats);
+                break;
+            case 'E':
+                err_flag |= !split_list(optarg, &assocs);
+                break;
+            case 's':
+                err_flag |= !split_list(optarg, &sets);
+                break;
+            case 'I':
+                err_flag |= !split_list(optarg, &index_fns);
+                break;
+            case 'b':
+                b = atoi(optarg);
+                break;
+            case 'n':
+                accesses = atoll(optarg);
+                break;
+            case 'r':
+                repeats = atoi(optarg);
+                break;
+            case 'm':
+                max_mb = atoi(optarg);
+                break;
+            case 'c':
+                coalesce = 1;
+                break;
+            case 'h':
+                usage(argv);
+                return 0;
+            default:
+                err_flag = 1;
+                break;
+        }
+    }
+    if (err_flag || (repeats < 1) || (accesses < 1)) {
+        usage(argv);
+        return -1;
+    }
+
+    char *output = (char *)malloc(MAX_OUTPUT);
+    for (int w = 0; w < workloads.n; w++) {
+        /* The workload in the binary format, from which the other formats are derived */
+        char binary[4096], path[4096], count[32];
+        snprintf(binary, sizeof(binary), "%s/csimbench.%d.%s.ctrace", dir, (int)getpid(), workloads.items[w]);
+        snprintf(count, sizeof(count), "%lld", accesses);
+        char *gen_args[] = { synth, "-p", workloads.items[w], "-n", count, "-f", "67108864", "-w", "30", "-o", binary,
+                             NULL };
+        run_result gen;
+        if (!run_tool(gen_args, 1, output, MAX_OUTPUT, &gen)) {
+            fprintf(stderr, "could not generate the %s workload with %s\n", workloads.items[w], synth);
+            return -3;
+        }
+
+        for (int f = 0; f < formats.n; f++) {
+            const char *format = formats.items[f];
+            snprintf(path, sizeof(path), "%s/csimbench.%d.%s.%s", dir, (int)getpid(), workloads.items[w], format);
+            if (strcmp(format, "text") == 0) {
+                char *args[] = { synth, "-p", workloads.items[w], "-n", count, "-f", "67108864", "-w", "30", "-x",
+                                 "-o", path, NULL };
+                gen.ok = run_tool(args, 1, output, MAX_OUTPUT, &gen);
+            } else if (strcmp(format, "zip") == 0) {
+                char *args[] = { zip, "-i", binary, "-o", path, NULL };
+                gen.ok = run_tool(args, 1, output, MAX_OUTPUT, &gen);
+            } else if (strcmp(format, "binary") == 0) {
+                snprintf(path, sizeof(path), "%s", binary);
+                gen.ok = 1;
+            } else {
+                gen.ok = 0;
+            }
+            if (!gen.ok) {
+                fprintf(stderr, "could not produce the %s format of the %s workload\n", format, workloads.items[w]);
+                continue;
+            }
+
+            for (int si = 0; si < sets.n; si++) {
+                for (int e = 0; e < assocs.n; e++) {
+                    for (int i = 0; i < index_fns.n; i++) {
+                        int s = atoi(sets.items[si]), E = atoi(assocs.items[e]);
+                        if (((double)E * sizeof(cache_line) * (1LL << s) + (1LL << s) * sizeof(cache_line *)) >
+                            (double)max_mb * (1 << 20)) {
+                            fprintf(stderr, "skipping s:%d E:%d, above %d MB\n", s, E, max_mb);
+                            continue;
+                        }
+                        char *args[16];
+                        int n = 0;
+                        args[n++] = csim;
+                        args[n++] = "-s";
+                        args[n++] = sets.items[si];
+                        args[n++] = "-E";
+                        args[n++] = assocs.items[e];
+                        args[n++] = "-b";
+                        char b_arg[16];
+                        snprintf(b_arg, sizeof(b_arg), "%d", b);
+                        args[n++] = b_arg;
+                        args[n++] = "-I";
+                        args[n++] = index_fns.items[i];
+                        args[n++] = "-t";
+                        args[n++] = path;
+                        if (coalesce) {
+                            args[n++] = "-c";
+                        }
+                        args[n] = NULL;
+
+                        run_result best;
+                        best.ok = 0;
+                        for (int r = 0; r < repeats; r++) {
+                            run_result res;
+                            if (!run_tool(args, 0, output, MAX_OUTPUT, &res)) {
+                                break;
+                            }
+                            /* The summary of the L1 data cache is the last line printed by csim */
+                            char *summary = strstr(output, "hits:");
+                            while ((summary != NULL) && (strstr(summary + 1, "\nhits:") != NULL)) {
+                                summary = strstr(summary + 1, "\nhits:") + 1;
+                            }
+                            if ((summary == NULL) ||
+                                (sscanf(summary, "hits:%lld misses:%lld", &res.hits, &res.misses) != 2)) {
+                                break;
+                            }
+                            if (!best.ok || (res.seconds < best.seconds)) {
+                                best = res;
+                            }
+                        }
+                        if (!best.ok) {
+                            fprintf(stderr, "csim failed on %s with s:%d E:%d\n", path, s, E);
+                            continue;
+                        }
+                        long long total = best.hits + best.misses;
+                        printf("bench workload:%s format:%s s:%d E:%d b:%d index:%s coalesce:%d accesses:%lld "
+                               "seconds:%.6f accesses_per_s:%.0f ns_per_access:%.2f peak_rss_kb:%ld misses:%lld\n",
+                               workloads.items[w], format, s, E, b, index_fns.items[i], coalesce, total,
+                               best.seconds, best.seconds > 0 ? total / best.seconds : 0.0,
+                               total ? best.seconds * 1e9 / total : 0.0, best.peak_rss_kb, best.misses);
+                        fflush(stdout);
+                    }
+                }
+            }
+            if (strcmp(format, "binary") != 0) {
+                remove(path);
+            }
+        }
+        remove(binary);
+    }
+    free(output);
+    return 0;
+}
+
+int run_tool(char *const args[], int quiet, char *output, int output_size, run_result *result) {
+/* run_tool runs args[0] with its standard output collected in output, and its standard error discarded if quiet, and
+ * returns 0 unless it exits with 0 */
+    int fds[2];
+    struct timespec start, end;
+    result -> ok = 0;
+    if (pipe(fds) != 0) {
+        return 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    if (pid < 0) {
+        return 0;
+    }
+    if (pid == 0) {
+        dup2(fds[1], 1);
+        close(fds[0]);
+        close(fds[1]);
+        if (quiet && (freopen("/dev/null", "w", stderr) == NULL)) {
+            _exit(127);
+        }
+        execv(args[0], args);
+        _exit(127);
+    }
+    close(fds[1]);
+    int len = 0;
+    ssize_t n;
+    while ((n = read(fds[0], output + len, output_size - 1 - len)) > 0) {
+        len += n;
+        if (len == output_size - 1) {
+            /* Only the beginning of a long output is kept, the rest is drained */
+            char sink[4096];
+            while (read(fds[0], sink, sizeof(sink)) > 0);
+            break;
+        }
+    }
+    output[len] = '\0';
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid) {
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result -> seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    result -> peak_rss_kb = usage.ru_maxrss;
+    result -> ok = WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+    return result -> ok;
+}
+
+int split_list(char *spec, list *l) {
+/* split_list splits spec in place at its commas and returns 0 if it has too many or no items */
+    l -> n = 0;
+    for (char *item = strtok(spec, ","); item != NULL; item = strtok(NULL, ",")) {
+        if (l -> n == MAX_LIST) {
+            return 0;
+        }
+        l -> items[l -> n++] = item;
+    }
+    return l -> n > 0;
+}
+
+void usage(char *argv[]) {
+    printf("%s [-hc] [-C <csim>] [-G <tracesynth>] [-Z <tracezip>] [-d <dir>] [-w <list>] [-f <list>] [-E <list>] [-s <list>] [-b <num>] [-I <list>] [-n <num>] [-r <num>] [-m <num>]\n", argv[0]);
+    printf("\nOptions:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -C <file>  The csim to measure, ./csim by default.\n");
+    printf("  -G <file>  The tracesynth generating the workloads, ./tracesynth by default.\n");
+    printf("  -Z <file>  The tracezip producing the zip format, ./tracezip by default.\n");
+    printf("  -d <dir>   Directory of the generated traces, /tmp by default.\n");
+    printf("  -w <list>  Workloads, patterns of tracesynth with 30%% stores : seq,random,zipf,submit by default.\n");
+    printf("  -f <list>  Trace formats : binary,text by default, or zip.\n");
+    printf("  -E <list>  Associativities : 1,4,16,64 by default.\n");
+    printf("  -s <list>  Numbers of set index bits : 5,10,15,20 by default.\n");
+    printf("  -b <num>   Number of block offset bits, 6 by default.\n");
+    printf("  -I <list>  Index functions : modulo by default, or xor, prime, skew.\n");
+    printf("  -n <num>   Accesses of the workloads, 1000000 by default.\n");
+    printf("  -r <num>   Runs of each combination, the fastest is reported. 3 by default.\n");
+    printf("  -m <num>   Largest cache simulated, in MB of cache lines. 1024 by default.\n");
+    printf("  -c         Run csim with the coalescing filter.\n");
+    printf("\nExample : %s -w zipf -f binary -E 1,2,4,8,16,32,64 -s 5,8,11,14,17,20\n", argv[0]);
+}
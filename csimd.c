@@ -0,0 +1,430 @@
+/* csimd.c - A simulation daemon, which keeps decoded traces in memory and simulates them on request, so that scripts
+ * running thousands of simulations of the same few traces pay neither the start of csim nor the decoding every time.
+ * Required inputs : none, traces can be loaded at start (-t) or on request
+ *
+ * csimd listens on a Unix socket (-u) and serves every connection on a thread of its own. A connection sends requests
+ * of one line and reads the answer to each before sending the next, an answer being any number of lines followed by a
+ * line "end". A request which fails is answered by a line "error <reason>" before the "end". The requests are:
+ *   load <id> <file> [<fmt>]   decodes a trace, in any format of csim, and keeps it under the name <id>
+ *   sim <id> <options>         simulates the trace <id> on the cache given by the options of csim, -s, -E, -b, -L and
+ *                              so on, and answers with what csim prints: the statistics and then the summary line
+ *                              "hits:<n> misses:<n> evictions:<n>"
+ *   list                       answers with a line "trace id:<id> file:<file> records:<n> accesses:<n>" per trace
+ *   quit                       closes the connection
+ *   shutdown                   stops the daemon
+ * The traces are kept as their records, runs and groups included, so the simulations take the fast paths of csim.
+ * The simulations run on a pool of -j threads, which bounds the load put on the machine however many scripts are
+ * connected; scripts wanting parallel simulations open several connections. -v is not available.
+ *
+ * With -q, csimd is a client instead: it sends the request to the daemon listening on the socket and prints the
+ * answer, for instance csimd -q "sim t1 -s 5 -E 1 -b 5".
+ *
+ * Build with : gcc -g -Wall -Werror -std=c99 -m64 -O2 -o csimd csimd.c cachesim.c trace.c -pthread */
+
+#define _DEFAULT_SOURCE
+#include "cachesim.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define DEFAULT_SOCKET "csimd.sock"
+#define MAX_TRACES 256
+#define MAX_ID 64
+#define MAX_REQUEST 4096
+#define MAX_ARGS 64
+
+/* A trace in memory, its records as they are in the file with the members of every group after its 'R' record */
+typedef struct {
+    char id[MAX_ID];
+    char *path;
+    trace_record *recs;
+    long long n, accesses;
+} loaded_trace;
+
+/* A simulation waiting for a thread of the pool, and its answer once done */
+typedef struct job {
+    const loaded_trace *trace;
+    sim_config cfg;
+    char *output;
+    size_t len;
+    int done;
+    pthread_cond_t cond;
+    struct job *next;
+} job;
+
+/* The traces are only ever added, a trace found in the table stays valid */
+static loaded_trace *traces[MAX_TRACES];
+static int num_traces;
+static pthread_mutex_t traces_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static job *queue_head, *queue_tail;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+
+static int listen_fd = -1;
+static volatile int stopping;
+
+int serve(const char *socket_path, int num_threads);
+int request(const char *socket_path, const char *line);
+void *worker(void *arg);
+void *connection(void *arg);
+int handle(char *line, FILE *out);
+const char *load_trace(const char *id, const char *path, int format);
+loaded_trace *find_trace(const char *id);
+void run_job(job *j);
+void usage(char *argv[]);
+
+int main(int argc, char *argv[]) {
+    extern char* optarg;
+    char *socket_path = DEFAULT_SOCKET, *query = NULL;
+    int c, err_flag = 0, format = TRACE_TEXT;
+    int num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    while((c = getopt(argc, argv, "u:j:t:f:q:h")) != -1) {
+        switch(c) {
+            case 'u':
+                socket_path = optarg;
+                break;
+            case 'j':
+                num_threads = atoi(optarg);
+                if (num_threads <= 0) {
+                    err_flag = 1;
+                }
+                break;
+            case 'f':
+                format = trace_parse_format(optarg);
+                if (format < 0) {
+                    err_flag = 1;
+                }
+                break;
+            case 't': {
+                /* id=file, loaded with the format of the last -f before it */
+                char *eq = strchr(optarg, '=');
+                if (eq == NULL) {
+                    err_flag = 1;
+                    break;
+                }
+                *eq = '\0';
+                const char *error = load_trace(optarg, eq + 1, format);
+                if (error != NULL) {
+                    fprintf(stderr, "%s: %s\n", eq + 1, error);
+                    return -3;
+                }
+                break;
+            }
+            case 'q':
+                query = optarg;
+                break;
+            case 'h':
+                usage(argv);
+                return 0;
+            default:
+                err_flag = 1;
+                break;
+        }
+    }
+    if (err_flag || (strlen(socket_path) >= sizeof(((struct sockaddr_un *)0) -> sun_path))) {
+        usage(argv);
+        return -1;
+    }
+    if (num_threads <= 0) {
+        num_threads = 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    if (query != NULL) {
+        return request(socket_path, query);
+    }
+    return serve(socket_path, num_threads);
+}
+
+int serve(const char *socket_path, int num_threads) {
+/* serve starts the pool and accepts connections until a shutdown request */
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);
+    if ((listen_fd < 0) || (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+        (listen(listen_fd, 64) != 0)) {
+        perror(socket_path);
+        return -2;
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker, NULL) != 0) {
+            perror("pthread_create");
+            return -2;
+        }
+        pthread_detach(thread);
+    }
+    fprintf(stderr, "csimd listening on %s with %d threads\n", socket_path, num_threads);
+
+    while (!stopping) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        pthread_t thread;
+        int *arg = (int *)malloc(sizeof(int));
+        *arg = fd;
+        if (pthread_create(&thread, NULL, connection, arg) != 0) {
+            close(fd);
+            free(arg);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    unlink(socket_path);
+    return 0;
+}
+
+int request(const char *socket_path, const char *line) {
+/* request sends a single request and copies the answer to standard output, it returns 1 if the answer is an error */
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((fd < 0) || (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)) {
+        perror(socket_path);
+        return -2;
+    }
+    FILE *in = fdopen(fd, "r+");
+    char answer[MAX_REQUEST];
+    int failed = 0;
+    fprintf(in, "%s\n", line);
+    fflush(in);
+    while (fgets(answer, sizeof(answer), in) != NULL) {
+        if (strcmp(answer, "end\n") == 0) {
+            break;
+        }
+        failed |= (strncmp(answer, "error ", 6) == 0);
+        fputs(answer, stdout);
+    }
+    fclose(in);
+    return failed;
+}
+
+void *worker(void *arg) {
+/* worker runs the simulations of the queue, one at a time */
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&queue_lock);
+        while (queue_head == NULL) {
+            pthread_cond_wait(&queue_cond, &queue_lock);
+        }
+        job *j = queue_head;
+        queue_head = j -> next;
+        if (queue_head == NULL) {
+            queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&queue_lock);
+
+        run_job(j);
+
+        pthread_mutex_lock(&queue_lock);
+        j -> done = 1;
+        pthread_cond_signal(&j -> cond);
+        pthread_mutex_unlock(&queue_lock);
+    }
+    return NULL;
+}
+
+void *connection(void *arg) {
+/* connection answers the requests of a client until it hangs up or quits */
+    int fd = *(int *)arg;
+    free(arg);
+    FILE *in = fdopen(fd, "r");
+    FILE *out = fdopen(dup(fd), "w");
+    char line[MAX_REQUEST];
+    while ((in != NULL) && (out != NULL) && (fgets(line, sizeof(line), in) != NULL)) {
+        if (!handle(line, out)) {
+            break;
+        }
+        fprintf(out, "end\n");
+        if (fflush(out) != 0) {
+            break;
+        }
+    }
+    if (in != NULL) {
+        fclose(in);
+    }
+    if (out != NULL) {
+        fclose(out);
+    }
+    return NULL;
+}
+
+int handle(char *line, FILE *out) {
+/* handle answers a request and returns 0 if the connection is to be closed */
+    char *args[MAX_ARGS], *save;
+    int n = 0;
+    for (char *tok = strtok_r(line, " \t\r\n", &save); tok != NULL; tok = strtok_r(NULL, " \t\r\n", &save)) {
+        if (n == MAX_ARGS) {
+            fprintf(out, "error too many arguments\n");
+            return 1;
+        }
+        args[n++] = tok;
+    }
+    if (n == 0) {
+        fprintf(out, "error empty request\n");
+    } else if (strcmp(args[0], "quit") == 0) {
+        return 0;
+    } else if (strcmp(args[0], "shutdown") == 0) {
+        stopping = 1;
+        shutdown(listen_fd, SHUT_RDWR);
+        return 0;
+    } else if (strcmp(args[0], "list") == 0) {
+        pthread_mutex_lock(&traces_lock);
+        for (int i = 0; i < num_traces; i++) {
+            fprintf(out, "trace id:%s file:%s records:%lld accesses:%lld\n", traces[i] -> id, traces[i] -> path,
+                    traces[i] -> n, traces[i] -> accesses);
+        }
+        pthread_mutex_unlock(&traces_lock);
+    } else if (strcmp(args[0], "load") == 0) {
+        int format = (n == 4) ? trace_parse_format(args[3]) : TRACE_TEXT;
+        const char *error = ((n != 3) && (n != 4)) ? "usage: load <id> <file> [<fmt>]" :
+                            (format < 0) ? "unknown trace format" : load_trace(args[1], args[2], format);
+        if (error != NULL) {
+            fprintf(out, "error %s\n", error);
+        } else {
+            loaded_trace *t = find_trace(args[1]);
+            fprintf(out, "trace id:%s file:%s records:%lld accesses:%lld\n", t -> id, t -> path, t -> n,
+                    t -> accesses);
+        }
+    } else if (strcmp(args[0], "sim") == 0) {
+        job j;
+        const char *error = (n < 2) ? "usage: sim <id> <options>" : NULL;
+        memset(&j, 0, sizeof(j));
+        if (error == NULL) {
+            j.trace = find_trace(args[1]);
+            error = (j.trace == NULL) ? "unknown trace" : sim_parse_args(&j.cfg, args + 2, n - 2);
+        }
+        if ((error == NULL) && j.cfg.verbose) {
+            error = "-v is not available in csimd";
+        }
+        if (error == NULL) {
+            error = sim_config_check(&j.cfg);
+        }
+        if (error != NULL) {
+            fprintf(out, "error %s\n", error);
+            return 1;
+        }
+
+        pthread_cond_init(&j.cond, NULL);
+        pthread_mutex_lock(&queue_lock);
+        if (queue_tail != NULL) {
+            queue_tail -> next = &j;
+        } else {
+            queue_head = &j;
+        }
+        queue_tail = &j;
+        pthread_cond_signal(&queue_cond);
+        while (!j.done) {
+            pthread_cond_wait(&j.cond, &queue_lock);
+        }
+        pthread_mutex_unlock(&queue_lock);
+        pthread_cond_destroy(&j.cond);
+
+        if (j.output != NULL) {
+            fwrite(j.output, 1, j.len, out);
+            free(j.output);
+        } else {
+            fprintf(out, "error the simulator could not be built\n");
+        }
+    } else {
+        fprintf(out, "error unknown request %s\n", args[0]);
+    }
+    return 1;
+}
+
+const char *load_trace(const char *id, const char *path, int format) {
+/* load_trace decodes the trace in path and adds it to the table, it returns why it could not */
+    if (strlen(id) >= MAX_ID) {
+        return "trace id too long";
+    }
+    if (find_trace(id) != NULL) {
+        return "trace id already in use";
+    }
+    trace_reader *r = trace_open_as(path, format);
+    if (r == NULL) {
+        return "could not open trace file";
+    }
+
+    loaded_trace *t = (loaded_trace *)calloc(1, sizeof(loaded_trace));
+    t -> recs = trace_read_all(r, &t -> n, &t -> accesses);
+    const char *error = (t -> recs == NULL) ? "malformed trace file or out of memory" : NULL;
+    trace_close(r);
+
+    pthread_mutex_lock(&traces_lock);
+    if ((error == NULL) && (num_traces == MAX_TRACES)) {
+        error = "too many traces";
+    }
+    for (int i = 0; (error == NULL) && (i < num_traces); i++) {
+        if (strcmp(traces[i] -> id, id) == 0) {
+            error = "trace id already in use";
+        }
+    }
+    if (error == NULL) {
+        strcpy(t -> id, id);
+        t -> path = strdup(path);
+        traces[num_traces++] = t;
+    }
+    pthread_mutex_unlock(&traces_lock);
+    if (error != NULL) {
+        free(t -> recs);
+        free(t);
+    }
+    return error;
+}
+
+loaded_trace *find_trace(const char *id) {
+    loaded_trace *found = NULL;
+    pthread_mutex_lock(&traces_lock);
+    for (int i = 0; (found == NULL) && (i < num_traces); i++) {
+        if (strcmp(traces[i] -> id, id) == 0) {
+            found = traces[i];
+        }
+    }
+    pthread_mutex_unlock(&traces_lock);
+    return found;
+}
+
+void run_job(job *j) {
+/* run_job simulates the trace of j and leaves what csim would print in j -> output, or a nullptr if the simulator
+ * could not be built */
+    simulator sim;
+    if (!simulator_init(&sim, &j -> cfg)) {
+        j -> output = NULL;
+        return;
+    }
+    simulate_records(&sim, j -> trace -> recs, j -> trace -> n);
+
+    FILE *out = open_memstream(&j -> output, &j -> len);
+    print_statistics(&sim, out);
+    fprintf(out, "hits:%lld misses:%lld evictions:%lld\n", sim.l1d.hits, sim.l1d.misses, sim.l1d.evictions);
+    fclose(out);
+    simulator_free(&sim);
+}
+
+void usage(char *argv[]) {
+    printf("%s [-h] [-u <socket>] [-j <num>] [-f <fmt>] [-t <id>=<file>]... [-q <request>]\n", argv[0]);
+    printf("\nOptions:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -u <path>  Unix socket to listen on, or to send the request of -q to (default %s).\n", DEFAULT_SOCKET);
+    printf("  -j <num>   Number of simulations run at once (default the number of processors).\n");
+    printf("  -f <fmt>   Format of the traces of the following -t : text or binary (detected), din, champsim or raw.\n");
+    printf("  -t <id>=<file> Load a trace at start under the name <id>.\n");
+    printf("  -q <request> Send a request to the daemon and print the answer instead of serving.\n");
+    printf("\nRequests : load <id> <file> [<fmt>], sim <id> <csim options>, list, quit, shutdown\n");
+    printf("\nExample : %s -t t1=traces/trans.trace &\n", argv[0]);
+    printf("          %s -q \"sim t1 -s 5 -E 1 -b 5\"\n", argv[0]);
+}
@@ -0,0 +1,308 @@
+/* csimsweep.c - Simulates a trace on a whole grid of configurations with a pool of worker processes.
+ * Required inputs : the trace (-t) and the file listing the configurations (-g)
+ *
+ * Each line of the grid file gives the options of csim for one configuration, "-s 5 -E 1 -b 5 -L 10:8:6" for
+ * instance; blank lines and lines starting with # are skipped. The trace is decoded once, before the workers are
+ * forked, into a shared mapping of a memory file (memfd), which is grown as the trace is decoded and which every worker
+ * reads in place, so the memory taken by the trace does not grow with the number of workers. The workers are
+ * processes rather than threads so that each has its own allocator and a crash only loses the configuration being
+ * simulated.
+ *
+ * The workers take the configurations in turn from a queue shared with the other workers: the index of the next
+ * configuration, incremented atomically, no lock involved. Each result is written into its own slot of a shared
+ * table and the table is printed in the order of the grid once every worker has exited, one line of key:value pairs
+ * per configuration:
+ *   sweep config:3 hits:9968 misses:6416 evictions:6384 l2_hits:11116 l2_misses:512 seconds:0.0012
+ *         options:-s 5 -E 1 -b 5 -L 8:4:6
+ * all on one line, with the L2 and TLB counts only when they are simulated. A configuration whose worker died is
+ * reported with status:failed, one the simulator rejects with status:invalid_config, and the time of the whole sweep
+ * goes to standard error. The grid is checked before the trace is decoded, so a configuration with no set or line is
+ * reported at its line of the grid file and the sweep does not start. A configuration gives the results of csim on it
+ * whichever worker simulates it, the random choices of the simulator, such as the lines flushed by -F partial, being
+ * seeded anew for every simulation.
+ *
+ * Build with : gcc -g -Wall -Werror -std=c99 -m64 -O2 -o csimsweep csimsweep.c cachesim.c trace.c */
+
+#define _GNU_SOURCE
+#include "cachesim.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAX_LINE 1024
+#define MAX_ARGS 64
+
+enum result_state { RESULT_PENDING, RESULT_CLAIMED, RESULT_DONE, RESULT_INVALID };
+
+/* The slot of a configuration in the shared table, a cache line of its own so that the workers never share lines */
+typedef struct {
+    int state, l2cache, tlb;
+    long long hits, misses, evictions, l2_hits, l2_misses, tlb_misses;
+    double seconds;
+} __attribute__((aligned(64))) sweep_result;
+
+/* The shared part of the sweep: the queue of configurations and the table of results */
+typedef struct {
+    long long next;
+    sweep_result results[];
+} sweep_state;
+
+/* A configuration of the grid */
+typedef struct {
+    char *options;
+    sim_config cfg;
+} grid_entry;
+
+/* The file behind the shared mapping of the trace, which an anonymous mapping lacks, grown with the mapping */
+static int trace_fd = -1;
+
+int read_grid(const char *path, grid_entry **grid);
+void *map_shared(size_t bytes, int fd);
+trace_record *grow_shared(trace_record *recs, long long capacity, long long new_capacity);
+void run_worker(sweep_state *state, const grid_entry grid[], int num_configs, const trace_record recs[], long long n);
+double seconds_now(void);
+void usage(char *argv[]);
+
+int main(int argc, char *argv[]) {
+    extern char* optarg;
+    char *trace_file = NULL, *grid_file = NULL;
+    int c, err_flag = 0, format = TRACE_TEXT;
+    int num_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    while((c = getopt(argc, argv, "t:f:g:j:h")) != -1) {
+        switch(c) {
+            case 't':
+                trace_file = optarg;
+                break;
+            case 'f':
+                format = trace_parse_format(optarg);
+                if (format < 0) {
+                    err_flag = 1;
+                }
+                break;
+            case 'g':
+                grid_file = optarg;
+                break;
+            case 'j':
+                num_workers = atoi(optarg);
+                if (num_workers <= 0) {
+                    err_flag = 1;
+                }
+                break;
+            case 'h':
+                usage(argv);
+                return 0;
+            default:
+                err_flag = 1;
+                break;
+        }
+    }
+    if ((trace_file == NULL) || (grid_file == NULL) || err_flag) {
+        usage(argv);
+        return -1;
+    }
+    if (num_workers <= 0) {
+        num_workers = 1;
+    }
+
+    grid_entry *grid;
+    int num_configs = read_grid(grid_file, &grid);
+    if (num_configs <= 0) {
+        return -1;
+    }
+
+    double start = seconds_now();
+    trace_reader *r = trace_open_as(trace_file, format);
+    if (r == NULL) {
+        fprintf(stderr, "could not open trace file %s\n", trace_file);
+        return -3;
+    }
+    /* The trace is decoded straight into the mapping, made before the fork so that the workers inherit it, which grows
+     * as it fills and is trimmed to the records once the trace is read */
+    long long n, accesses, capacity = 1 << 16;
+    trace_record *recs = NULL;
+    trace_fd = memfd_create("csimsweep-trace", 0);
+    if ((trace_fd >= 0) && (ftruncate(trace_fd, capacity * sizeof(trace_record)) == 0)) {
+        recs = (trace_record *)map_shared(capacity * sizeof(trace_record), trace_fd);
+    }
+    sweep_state *state = (sweep_state *)map_shared(sizeof(sweep_state) + num_configs * sizeof(sweep_result), -1);
+    if ((recs == NULL) || (state == NULL)) {
+        fprintf(stderr, "could not map the shared memory\n");
+        return -2;
+    }
+    int decoded = trace_read_into(r, &recs, &capacity, grow_shared, &n, &accesses);
+    trace_close(r);
+    if (!decoded) {
+        fprintf(stderr, "malformed trace file %s, or out of memory\n", trace_file);
+        return -3;
+    }
+    size_t trace_bytes = (n > 0 ? n : 1) * sizeof(trace_record);
+    mremap(recs, capacity * sizeof(trace_record), trace_bytes, 0);
+    if (ftruncate(trace_fd, trace_bytes) != 0) {
+        perror("ftruncate");
+    }
+    close(trace_fd);
+    double decoded_at = seconds_now();
+
+    if (num_workers > num_configs) {
+        num_workers = num_configs;
+    }
+    for (int w = 0; w < num_workers; w++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        if (pid == 0) {
+            run_worker(state, grid, num_configs, recs, n);
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0);
+
+    for (int i = 0; i < num_configs; i++) {
+        sweep_result *res = &state -> results[i];
+        printf("sweep config:%d", i);
+        if (res -> state == RESULT_INVALID) {
+            printf(" status:invalid_config");
+        } else if (res -> state != RESULT_DONE) {
+            printf(" status:%s", (res -> state == RESULT_CLAIMED) ? "failed" : "not_run");
+        } else {
+            printf(" hits:%lld misses:%lld evictions:%lld", res -> hits, res -> misses, res -> evictions);
+            if (res -> l2cache) {
+                printf(" l2_hits:%lld l2_misses:%lld", res -> l2_hits, res -> l2_misses);
+            }
+            if (res -> tlb) {
+                printf(" tlb_misses:%lld", res -> tlb_misses);
+            }
+            printf(" seconds:%.4f", res -> seconds);
+        }
+        printf(" options:%s\n", grid[i].options);
+    }
+    fprintf(stderr, "sweep configs:%d workers:%d records:%lld accesses:%lld trace_mb:%.1f decode_seconds:%.3f "
+            "sweep_seconds:%.3f\n", num_configs, num_workers, n, accesses, trace_bytes / 1048576.0, decoded_at - start,
+            seconds_now() - decoded_at);
+    return 0;
+}
+
+int read_grid(const char *path, grid_entry **grid) {
+/* read_grid parses the configurations of the grid file and returns their number, or -1 after reporting the first
+ * line which does not describe a configuration */
+    FILE *fp = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "could not open grid file %s\n", path);
+        return -1;
+    }
+    char line[MAX_LINE];
+    int num = 0, capacity = 64, line_number = 0;
+    *grid = (grid_entry *)malloc(capacity * sizeof(grid_entry));
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char words[MAX_LINE], *args[MAX_ARGS], *save;
+        int n = 0;
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        strcpy(words, line);
+        for (char *tok = strtok_r(words, " \t", &save); (tok != NULL) && (n < MAX_ARGS);
+             tok = strtok_r(NULL, " \t", &save)) {
+            args[n++] = tok;
+        }
+        if ((n == 0) || (args[0][0] == '#')) {
+            continue;
+        }
+        if (num == capacity) {
+            capacity *= 2;
+            *grid = (grid_entry *)realloc(*grid, capacity * sizeof(grid_entry));
+        }
+        const char *error = sim_parse_args(&(*grid)[num].cfg, args, n);
+        if ((error == NULL) && (*grid)[num].cfg.verbose) {
+            error = "-v is not available in a sweep";
+        }
+        if (error == NULL) {
+            error = sim_config_check(&(*grid)[num].cfg);
+        }
+        if (error != NULL) {
+            fprintf(stderr, "%s:%d: %s\n", path, line_number, error);
+            return -1;
+        }
+        (*grid)[num].options = strdup(line);
+        num++;
+    }
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    if (num == 0) {
+        fprintf(stderr, "no configuration in %s\n", path);
+    }
+    return num;
+}
+
+void *map_shared(size_t bytes, int fd) {
+/* map_shared maps bytes of the file fd, or of anonymous memory if fd is -1, shared with the forked workers */
+    void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | ((fd < 0) ? MAP_ANONYMOUS : 0), fd, 0);
+    return (p == MAP_FAILED) ? NULL : p;
+}
+
+trace_record *grow_shared(trace_record *recs, long long capacity, long long new_capacity) {
+/* grow_shared extends the file of the trace and moves the records to a larger mapping of it, which the kernel does
+ * without copying them */
+    if (ftruncate(trace_fd, new_capacity * sizeof(trace_record)) != 0) {
+        return NULL;
+    }
+    void *p = mremap(recs, capacity * sizeof(trace_record), new_capacity * sizeof(trace_record), MREMAP_MAYMOVE);
+    return (p == MAP_FAILED) ? NULL : (trace_record *)p;
+}
+
+void run_worker(sweep_state *state, const grid_entry grid[], int num_configs, const trace_record recs[], long long n) {
+/* run_worker simulates the configurations it takes from the queue until there are none left */
+    for (;;) {
+        long long i = __atomic_fetch_add(&state -> next, 1, __ATOMIC_RELAXED);
+        if (i >= num_configs) {
+            return;
+        }
+        sweep_result *res = &state -> results[i];
+        res -> state = RESULT_CLAIMED;
+
+        simulator sim;
+        double start = seconds_now();
+        if (!simulator_init(&sim, &grid[i].cfg)) {
+            __atomic_store_n(&res -> state, RESULT_INVALID, __ATOMIC_RELEASE);
+            continue;
+        }
+        simulate_records(&sim, recs, n);
+        res -> seconds = seconds_now() - start;
+        res -> hits = sim.l1d.hits;
+        res -> misses = sim.l1d.misses;
+        res -> evictions = sim.l1d.evictions;
+        res -> l2cache = sim.l2cache;
+        res -> l2_hits = sim.l2cache ? sim.l2.hits : 0;
+        res -> l2_misses = sim.l2cache ? sim.l2.misses : 0;
+        res -> tlb = (sim.tlb != NULL);
+        res -> tlb_misses = sim.tlb_misses;
+        simulator_free(&sim);
+        __atomic_store_n(&res -> state, RESULT_DONE, __ATOMIC_RELEASE);
+    }
+}
+
+double seconds_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void usage(char *argv[]) {
+    printf("%s [-h] -t <file> -g <file> [-f <fmt>] [-j <num>]\n", argv[0]);
+    printf("\nOptions:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -t <file>  Trace file, - for standard input.\n");
+    printf("  -f <fmt>   Format of the trace : text or binary (detected), din, champsim or raw.\n");
+    printf("  -g <file>  Configurations, one line of csim options each, - for standard input.\n");
+    printf("  -j <num>   Number of worker processes (default the number of processors).\n");
+    printf("\nExample : %s -t traces/trans.trace -g grid.txt -j 8\n", argv[0]);
+}
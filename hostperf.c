@@ -0,0 +1,159 @@
+/* hostperf.c - The caches and the performance counters of the host, see hostperf.h */
+
+#define _DEFAULT_SOURCE
+#include "hostperf.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#endif
+
+const char *hostperf_names[HOSTPERF_METRICS] = {"l1d", "llc", "dtlb"};
+
+int host_cache_read(int want_level, host_cache *hc) {
+/* host_cache_read scans the caches of cpu0 in sysfs, skipping the instruction caches */
+    hc -> found = 0;
+    for (int index = 0; ; index++) {
+        char path[256], type[32];
+        int values[4];
+        const char *files[4] = {"level", "number_of_sets", "ways_of_associativity", "coherency_line_size"};
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", index);
+        FILE *fp = fopen(path, "r");
+        if (fp == NULL) {
+            break;
+        }
+        int ok = (fscanf(fp, "%31s", type) == 1);
+        fclose(fp);
+        for (int i = 0; ok && (i < 4); i++) {
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/%s", index, files[i]);
+            fp = fopen(path, "r");
+            ok = (fp != NULL) && (fscanf(fp, "%d", &values[i]) == 1) && (values[i] > 0);
+            if (fp != NULL) {
+                fclose(fp);
+            }
+        }
+        if (!ok || (strcmp(type, "Instruction") == 0)) {
+            continue;
+        }
+        if ((want_level == 0) ? (!hc -> found || (values[0] > hc -> level)) : (values[0] == want_level)) {
+            hc -> found = 1;
+            hc -> level = values[0];
+            hc -> sets = values[1];
+            hc -> assoc = values[2];
+            hc -> line = values[3];
+        }
+    }
+    return hc -> found;
+}
+
+size_t hostperf_flush_bytes(void) {
+    host_cache llc;
+    if (!host_cache_read(0, &llc)) {
+        return HOSTPERF_FLUSH_BYTES;
+    }
+    return 2 * (size_t)llc.sets * llc.assoc * llc.line;
+}
+
+void hostperf_flush(volatile char *buffer, size_t bytes) {
+    for (size_t i = 0; i < bytes; i += 64) {
+        buffer[i]++;
+    }
+}
+
+double hostperf_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#ifdef __linux__
+static int open_event(int cache_id, int op) {
+/* open_event counts the misses of op on the hardware cache cache_id in user mode on the calling thread */
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = cache_id | (op << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+int hostperf_open(hostperf *hp) {
+    hp -> measured = 0;
+    for (int k = 0; k < HOSTPERF_METRICS; k++) {
+        hp -> read_fd[k] = hp -> write_fd[k] = -1;
+#ifdef __linux__
+        static const int cache_ids[HOSTPERF_METRICS] = {PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_LL,
+                                                        PERF_COUNT_HW_CACHE_DTLB};
+        hp -> read_fd[k] = open_event(cache_ids[k], PERF_COUNT_HW_CACHE_OP_READ);
+        if (hp -> read_fd[k] < 0) {
+            fprintf(stderr, "%s misses cannot be counted: %s\n", hostperf_names[k], strerror(errno));
+            continue;
+        }
+        hp -> write_fd[k] = open_event(cache_ids[k], PERF_COUNT_HW_CACHE_OP_WRITE);
+        hp -> measured |= (1 << k);
+#endif
+    }
+    return hp -> measured;
+}
+
+void hostperf_enable(hostperf *hp, int enable) {
+#ifdef __linux__
+    for (int k = 0; k < HOSTPERF_METRICS; k++) {
+        int fds[2] = {hp -> read_fd[k], hp -> write_fd[k]};
+        for (int i = 0; i < 2; i++) {
+            if (fds[i] < 0) {
+                continue;
+            }
+            if (enable) {
+                ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+                ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+            } else {
+                ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+    }
+#else
+    (void)hp;
+    (void)enable;
+#endif
+}
+
+void hostperf_read(hostperf *hp, long long values[]) {
+    for (int k = 0; k < HOSTPERF_METRICS; k++) {
+        int fds[2] = {hp -> read_fd[k], hp -> write_fd[k]};
+        values[k] = 0;
+        for (int i = 0; i < 2; i++) {
+            /* The count, the time enabled and the time running */
+            uint64_t data[3];
+            if ((fds[i] < 0) || (read(fds[i], data, sizeof(data)) != sizeof(data))) {
+                continue;
+            }
+            if ((data[2] > 0) && (data[2] < data[1])) {
+                data[0] = (uint64_t)((double)data[0] * data[1] / data[2]);
+            }
+            values[k] += (long long)data[0];
+        }
+    }
+}
+
+void hostperf_close(hostperf *hp) {
+    for (int k = 0; k < HOSTPERF_METRICS; k++) {
+        if (hp -> read_fd[k] >= 0) {
+            close(hp -> read_fd[k]);
+        }
+        if (hp -> write_fd[k] >= 0) {
+            close(hp -> write_fd[k]);
+        }
+    }
+}
@@ -0,0 +1,51 @@
+/* hostperf.h - The caches and the performance counters of the machine running the tools, used to compare what the
+ * simulator predicts with what the hardware does
+ *
+ * The counters are opened with perf_event_open on the calling thread and count in user mode only. Each metric adds
+ * the read and the write misses of one hardware cache, the write event being optional as many processors have none.
+ * A metric whose read event cannot be opened, as in most virtual machines or with a restrictive perf_event_paranoid,
+ * is left out of the mask returned by hostperf_open and reads as 0. Outside of Linux no metric is ever measured. */
+
+#ifndef HOSTPERF_H
+#define HOSTPERF_H
+
+#include <stddef.h>
+
+/* The size of the buffer which empties the caches when the last level cache is unknown */
+#define HOSTPERF_FLUSH_BYTES (64 << 20)
+
+enum hostperf_metric { HOSTPERF_L1D, HOSTPERF_LLC, HOSTPERF_DTLB, HOSTPERF_METRICS };
+
+/* The names of the metrics, l1d, llc and dtlb, as used in the output of the tools */
+extern const char *hostperf_names[HOSTPERF_METRICS];
+
+/* A cache of the host as described in sysfs */
+typedef struct {
+    int found, level, sets, assoc, line;
+} host_cache;
+
+typedef struct {
+    int read_fd[HOSTPERF_METRICS], write_fd[HOSTPERF_METRICS];
+    /* The mask of the metrics which are measured */
+    int measured;
+} hostperf;
+
+/* host_cache_read describes the data cache of cpu0 at want_level, or its last level cache if want_level is 0, and
+ * returns hc -> found */
+int host_cache_read(int want_level, host_cache *hc);
+/* hostperf_flush_bytes returns the size of a buffer twice as large as the last level cache */
+size_t hostperf_flush_bytes(void);
+/* hostperf_flush evicts everything else from the caches and the TLB by writing a byte of every line of buffer */
+void hostperf_flush(volatile char *buffer, size_t bytes);
+double hostperf_seconds(void);
+
+/* hostperf_open opens the counters, reports the metrics which cannot be measured on standard error and returns the
+ * mask of those which can */
+int hostperf_open(hostperf *hp);
+/* hostperf_enable starts the counters from zero, or stops them */
+void hostperf_enable(hostperf *hp, int enable);
+/* hostperf_read stores the count of every metric, scaled up when the events were multiplexed */
+void hostperf_read(hostperf *hp, long long values[]);
+void hostperf_close(hostperf *hp);
+
+#endif
@@ -0,0 +1,220 @@
+/* hosttune.c - Times the transposes of trans.c on the host and keeps the fastest for each matrix size in the tuning
+ * database consulted by transpose_host (see transhost.h).
+ * Required inputs : none, the matrix sizes, the tiles and the database have defaults
+ *
+ * For each of the -m sizes, every registered transpose is timed, as are transpose_geometry on the L1 data cache of the
+ * host and transpose_tiled on every tile of -k rows by -k columns in each of the TILE_ORDERS orders, with and without
+ * the deferral of the diagonal. A sample repeats the transpose until it has run for MIN_SAMPLE_SECONDS at least, on
+ * matrices already in the caches as in a program transposing them over and over, and the fastest of -r samples is
+ * kept. Transposes which do not produce the transpose are left out. One line is printed per size:
+ *   hosttune M:64 N:64 ns:1830 submit_ns:2950 tile_rows:8 tile_cols:16 order:2 defer:0 variant:Tiled transpose
+ * all on one line, the fastest variant with its time per transpose and that of transpose_submit. The winners are then
+ * written to the database -d, replacing the tunings of the same sizes on the same host, unless -n is given.
+ *
+ * Build with : gcc -g -Wall -Werror -std=c99 -m64 -O2 -o hosttune hosttune.c transhost.c hostperf.c trans.c
+ *                  cachelab.c */
+
+#include "cachelab.h"
+#include "transhost.h"
+#include "hostperf.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+
+#define MAX_DIM 1024
+#define MAX_SIZES 32
+#define MAX_TILES 32
+#define DEFAULT_SIZES "32x32,64x64,61x67"
+#define DEFAULT_TILES "4,8,16,32"
+#define MIN_SAMPLE_SECONDS 1e-4
+
+extern trans_func_t func_list[MAX_TRANS_FUNCS];
+extern int func_counter;
+void registerFunctions(void);
+void transpose_submit(int M, int N, int A[N][M], int B[M][N]);
+
+static int matrices[2][MAX_DIM * MAX_DIM] __attribute__((aligned(64)));
+
+/* The tuning of the candidate being timed, a nullptr for the registered transposes */
+static const trans_tuning *candidate;
+static trans_host_fn candidate_func;
+
+int parse_list(char *spec, int values[], int max);
+double time_candidate(int M, int N, int reps, int runs, int *correct);
+void usage(char *argv[]);
+
+int main(int argc, char *argv[]) {
+    extern char* optarg;
+    int c, err_flag = 0, runs = 5, store = 1;
+    char default_sizes[] = DEFAULT_SIZES, default_tiles[] = DEFAULT_TILES;
+    char *sizes_spec = default_sizes, *tiles_spec = default_tiles, *db_file = TRANS_DB_DEFAULT;
+    int num_sizes = 0, rows[MAX_SIZES], cols[MAX_SIZES], tiles[MAX_TILES];
+
+    while((c = getopt(argc, argv, "m:k:r:d:nh")) != -1) {
+        switch(c) {
+            case 'm':
+                sizes_spec = optarg;
+                break;
+            case 'k':
+                tiles_spec = optarg;
+                break;
+            case 'r':
+                runs = atoi(optarg);
+                break;
+            case 'd':
+                db_file = optarg;
+                break;
+            case 'n':
+                store = 0;
+                break;
+            case 'h':
+                usage(argv);
+                return 0;
+            default:
+                err_flag = 1;
+                break;
+        }
+    }
+    for (char *item = strtok(sizes_spec, ","); item != NULL; item = strtok(NULL, ",")) {
+        int m, n;
+        char rest;
+        if ((num_sizes == MAX_SIZES) || (sscanf(item, "%dx%d%c", &m, &n, &rest) != 2) || (m <= 0) || (n <= 0) ||
+            (m > MAX_DIM) || (n > MAX_DIM)) {
+            err_flag = 1;
+            break;
+        }
+        cols[num_sizes] = m;
+        rows[num_sizes] = n;
+        num_sizes++;
+    }
+    int num_tiles = parse_list(tiles_spec, tiles, MAX_TILES);
+    if ((num_sizes == 0) || (num_tiles <= 0) || (runs <= 0) || err_flag) {
+        usage(argv);
+        return -1;
+    }
+
+    char host[TRANS_HOST_MAX_KEY];
+    if (!trans_host_key(host, sizeof(host))) {
+        fprintf(stderr, "the description of the host is too long\n");
+        return -1;
+    }
+    printf("hosttune host:%s\n", host);
+    registerFunctions();
+
+    trans_host_tuning winners[MAX_SIZES];
+    for (int z = 0; z < num_sizes; z++) {
+        int M = cols[z], N = rows[z], correct;
+        trans_host_tuning *best = &winners[z];
+        trans_tuning t;
+        memset(&t, 0, sizeof(t));
+        t.M = M;
+        t.N = N;
+
+        /* The number of transposes per sample, from a single run of transpose_submit */
+        candidate = NULL;
+        candidate_func = transpose_submit;
+        double once = time_candidate(M, N, 1, 1, &correct);
+        int reps = (once < MIN_SAMPLE_SECONDS) ? (int)(MIN_SAMPLE_SECONDS / (once > 1e-9 ? once : 1e-9)) + 1 : 1;
+        double submit_seconds = time_candidate(M, N, reps, runs, &correct);
+
+        best -> ns = -1;
+        for (int f = 0; f <= func_counter; f++) {
+            candidate_func = (f < func_counter) ? func_list[f].func_ptr : transpose_host_geometry;
+            double seconds = time_candidate(M, N, reps, runs, &correct);
+            if (correct && ((best -> ns < 0) || (seconds * 1e9 < best -> ns))) {
+                best -> tiling = t;
+                best -> ns = (long long)(seconds * 1e9);
+                snprintf(best -> variant, sizeof(best -> variant), "%s",
+                         (f < func_counter) ? func_list[f].description : TRANS_GEOMETRY_DESC);
+            }
+        }
+        candidate_func = NULL;
+        candidate = &t;
+        for (int r = 0; r < num_tiles; r++) {
+            for (int k = 0; k < num_tiles; k++) {
+                t.tile_rows = tiles[r];
+                t.tile_cols = tiles[k];
+                if ((t.tile_rows > N) || (t.tile_cols > M)) {
+                    continue;
+                }
+                for (t.order = 0; t.order < TILE_ORDERS; t.order++) {
+                    for (t.defer_diagonal = 0; t.defer_diagonal <= 1; t.defer_diagonal++) {
+                        double seconds = time_candidate(M, N, reps, runs, &correct);
+                        if (correct && ((best -> ns < 0) || (seconds * 1e9 < best -> ns))) {
+                            best -> tiling = t;
+                            best -> ns = (long long)(seconds * 1e9);
+                            snprintf(best -> variant, sizeof(best -> variant), "%s", TRANS_TILED_DESC);
+                        }
+                    }
+                }
+            }
+        }
+        candidate = NULL;
+
+        printf("hosttune M:%d N:%d ns:%lld submit_ns:%.0f", M, N, best -> ns, submit_seconds * 1e9);
+        if (strcmp(best -> variant, TRANS_TILED_DESC) == 0) {
+            printf(" tile_rows:%d tile_cols:%d order:%d defer:%d", best -> tiling.tile_rows, best -> tiling.tile_cols,
+                   best -> tiling.order, best -> tiling.defer_diagonal);
+        }
+        printf(" variant:%s\n", best -> variant);
+    }
+
+    if (store && !trans_db_store(db_file, host, winners, num_sizes)) {
+        fprintf(stderr, "could not write %s\n", db_file);
+        return -3;
+    }
+    return 0;
+}
+
+int parse_list(char *spec, int values[], int max) {
+/* parse_list reads the comma-separated positive numbers of spec, and returns their number or -1 */
+    int n = 0;
+    for (char *item = strtok(spec, ","); item != NULL; item = strtok(NULL, ",")) {
+        char rest;
+        if ((n == max) || (sscanf(item, "%d%c", &values[n], &rest) != 1) || (values[n] <= 0)) {
+            return -1;
+        }
+        n++;
+    }
+    return n;
+}
+
+double time_candidate(int M, int N, int reps, int runs, int *correct) {
+/* time_candidate returns the fastest time of a transpose over runs samples of reps transposes, and checks the result */
+    int (*A)[M] = (int (*)[M])matrices[0];
+    int (*B)[N] = (int (*)[N])matrices[1];
+    double best = 0;
+    initMatrix(M, N, A, B);
+    for (int r = 0; r < runs; r++) {
+        double start = hostperf_seconds();
+        for (int i = 0; i < reps; i++) {
+            if (candidate != NULL) {
+                transpose_tiled(M, N, A, B, candidate);
+            } else {
+                (*candidate_func)(M, N, A, B);
+            }
+        }
+        double seconds = (hostperf_seconds() - start) / reps;
+        best = ((r == 0) || (seconds < best)) ? seconds : best;
+    }
+    *correct = 1;
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < M; j++) {
+            *correct = *correct && (A[i][j] == B[j][i]);
+        }
+    }
+    return best;
+}
+
+void usage(char *argv[]) {
+    printf("%s [-hn] [-m <MxN,...>] [-k <num,...>] [-r <num>] [-d <file>]\n", argv[0]);
+    printf("\nOptions:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -m <list>  Comma-separated matrix sizes, M columns by N rows (default %s).\n", DEFAULT_SIZES);
+    printf("  -k <list>  Comma-separated rows and columns of the tiles tried (default %s).\n", DEFAULT_TILES);
+    printf("  -r <num>   Number of samples of each transpose, the fastest is kept (default 5).\n");
+    printf("  -d <file>  Tuning database (default %s).\n", TRANS_DB_DEFAULT);
+    printf("  -n         Print the winners without writing them to the database.\n");
+    printf("\nExample : %s -m 32x32,64x64,61x67,1024x1024 -k 4,8,16,32,64\n", argv[0]);
+}
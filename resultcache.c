@@ -0,0 +1,158 @@
+/* resultcache.c - The persistent cache of the results of csim, see resultcache.h */
+
+#define _DEFAULT_SOURCE
+#include "resultcache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define FINGERPRINT_MAGIC "csimfp1"
+#define HASH_MULTIPLIER 0x9e3779b97f4a7c15ULL
+#define HASH_READ_BYTES (1 << 20)
+
+static unsigned long long hash_bytes(unsigned long long h, const unsigned char *p, size_t n) {
+/* hash_bytes mixes n bytes into h, a word at a time */
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * HASH_MULTIPLIER;
+        h ^= h >> 32;
+    }
+    for (; i < n; i++) {
+        h = (h ^ p[i]) * HASH_MULTIPLIER;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+static int write_atomically(const char *path, const char *text, size_t len) {
+/* write_atomically replaces the file path by one holding text, through a temporary file private to the process */
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp%ld", path, (long)getpid()) >= (int)sizeof(tmp)) {
+        return 0;
+    }
+    FILE *fp = fopen(tmp, "w");
+    if (fp == NULL) {
+        return 0;
+    }
+    int ok = (fwrite(text, 1, len, fp) == len);
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || (rename(tmp, path) != 0)) {
+        unlink(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+int trace_fingerprint(const char *path, unsigned long long *fp) {
+/* The sidecar is trusted as long as the size and the modification time of the trace, to the nanosecond, match */
+    struct stat st;
+    char sidecar[4096], text[128];
+    if ((stat(path, &st) != 0) || !S_ISREG(st.st_mode) ||
+        (snprintf(sidecar, sizeof(sidecar), "%s.fp", path) >= (int)sizeof(sidecar))) {
+        return 0;
+    }
+
+    FILE *in = fopen(sidecar, "r");
+    if (in != NULL) {
+        long long size, sec, nsec;
+        int ok = (fscanf(in, FINGERPRINT_MAGIC " %lld %lld %lld %llx", &size, &sec, &nsec, fp) == 4);
+        fclose(in);
+        if (ok && (size == (long long)st.st_size) && (sec == (long long)st.st_mtim.tv_sec) &&
+            (nsec == (long long)st.st_mtim.tv_nsec)) {
+            return 1;
+        }
+    }
+
+    in = fopen(path, "rb");
+    unsigned char *buf = (unsigned char *)malloc(HASH_READ_BYTES);
+    if ((in == NULL) || (buf == NULL)) {
+        if (in != NULL) {
+            fclose(in);
+        }
+        free(buf);
+        return 0;
+    }
+    unsigned long long h = 0, total = 0;
+    size_t n;
+    while ((n = fread(buf, 1, HASH_READ_BYTES, in)) > 0) {
+        h = hash_bytes(h, buf, n);
+        total += n;
+    }
+    int ok = !ferror(in);
+    fclose(in);
+    free(buf);
+    if (!ok) {
+        return 0;
+    }
+    *fp = hash_bytes(h, (const unsigned char *)&total, sizeof(total));
+
+    /* A trace in a directory which cannot be written is fingerprinted every time */
+    int len = snprintf(text, sizeof(text), FINGERPRINT_MAGIC " %lld %lld %lld %016llx\n", (long long)st.st_size,
+                       (long long)st.st_mtim.tv_sec, (long long)st.st_mtim.tv_nsec, *fp);
+    write_atomically(sidecar, text, len);
+    return 1;
+}
+
+int result_key(const char *path, int format, const sim_config *cfg, char *key, int size) {
+    unsigned long long fp;
+    char config[RESULT_MAX_KEY];
+    if (cfg -> verbose || (strcmp(path, "-") == 0) || !trace_fingerprint(path, &fp) ||
+        !sim_config_key(cfg, config, sizeof(config))) {
+        return 0;
+    }
+    int n = snprintf(key, size, "csim-result-v%d trace:%016llx format:%d %s", RESULT_VERSION, fp, format, config);
+    return (n >= 0) && (n < size);
+}
+
+static int result_path(const char *dir, const char *key, char *path, int size) {
+    unsigned long long h = hash_bytes(0, (const unsigned char *)key, strlen(key));
+    int n = snprintf(path, size, "%s/%016llx", dir, h);
+    return (n >= 0) && (n < size);
+}
+
+int result_lookup(const char *dir, const char *key, FILE *out, long long counts[3]) {
+    char path[4096], line[RESULT_MAX_KEY + 2];
+    if (!result_path(dir, key, path, sizeof(path))) {
+        return 0;
+    }
+    FILE *in = fopen(path, "r");
+    if (in == NULL) {
+        return 0;
+    }
+    size_t len = strlen(key);
+    int ok = (fgets(line, sizeof(line), in) != NULL) && (strncmp(line, key, len) == 0) && (line[len] == '\n') &&
+             (fscanf(in, "summary %lld %lld %lld\n", &counts[0], &counts[1], &counts[2]) == 3);
+    if (ok) {
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+            fwrite(buf, 1, n, out);
+        }
+    }
+    fclose(in);
+    return ok;
+}
+
+int result_store(const char *dir, const char *key, simulator *sim) {
+    char path[4096];
+    char *text = NULL;
+    size_t len = 0;
+    if (!result_path(dir, key, path, sizeof(path)) || ((mkdir(dir, 0777) != 0) && (errno != EEXIST))) {
+        return 0;
+    }
+    FILE *out = open_memstream(&text, &len);
+    if (out == NULL) {
+        return 0;
+    }
+    fprintf(out, "%s\nsummary %lld %lld %lld\n", key, sim -> l1d.hits, sim -> l1d.misses, sim -> l1d.evictions);
+    print_statistics(sim, out);
+    fclose(out);
+    int ok = write_atomically(path, text, len);
+    free(text);
+    return ok;
+}
@@ -0,0 +1,36 @@
+/* resultcache.h - A persistent cache of the results of csim, so that simulating the same trace on the same configuration
+ * again returns at once
+ *
+ * A result is identified by the fingerprint of the trace, a 64-bit hash of its contents, the format it is read in, the
+ * configuration of the simulation and RESULT_VERSION. The fingerprint of a trace is kept in the sidecar file
+ * <trace>.fp along with the size and modification time of the trace, and is only computed again, by reading the whole
+ * trace, when they change or the sidecar is missing. A trace on standard input is never cached.
+ *
+ * The cache is a directory holding a file per result, named after a hash of its key. The file repeats the whole key on
+ * its first line, which guards against collisions of the hash, then gives the summary and the statistics as csim
+ * prints them. Files, sidecars included, are written under a temporary name and renamed into place, so that any number
+ * of processes sharing the cache, such as the workers of a sweep, only ever see complete files without locking. */
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include "cachesim.h"
+#include <stdio.h>
+
+/* Changed whenever a change to the simulator changes its results, to make the results cached before it unreachable */
+#define RESULT_VERSION 4
+#define RESULT_MAX_KEY 512
+
+/* trace_fingerprint stores the fingerprint of the trace in path in fp, from its sidecar when it is up to date, and
+ * returns 0 if the trace cannot be read */
+int trace_fingerprint(const char *path, unsigned long long *fp);
+/* result_key writes the key of simulating the trace in path into key, and returns 0 if the result cannot be cached:
+ * the trace is standard input or cannot be read, or -v prints every access */
+int result_key(const char *path, int format, const sim_config *cfg, char *key, int size);
+/* result_lookup prints the statistics of a cached result to out and stores its hits, misses and evictions in counts,
+ * or returns 0 if the result is not in the cache */
+int result_lookup(const char *dir, const char *key, FILE *out, long long counts[3]);
+/* result_store adds the result of the simulation sim to the cache and returns 0 if it could not be written */
+int result_store(const char *dir, const char *key, simulator *sim);
+
+#endif
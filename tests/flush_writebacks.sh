@@ -0,0 +1,42 @@
+#!/bin/sh
+# flush_writebacks.sh - Checks that the lines a context switch flushes (-F) are written back when they are dirty.
+# Required inputs : the csim to test, ./csim by default
+#
+# A store-heavy trace dirties eight lines, switches to another address space (an X record) and reads four of them
+# back. Every line of the 16-line direct mapped cache is flushed with -F full, so all eight stores are written back,
+# and a sectored cache writes back one dirty sector per line. -F partial writes back exactly the lines it flushes,
+# which are all dirty, and without -F nothing is written back.
+#
+# Run with : sh tests/flush_writebacks.sh ./csim
+
+CSIM=${1:-./csim}
+TRACE=$(mktemp)
+trap 'rm -f "$TRACE"' EXIT
+status=0
+
+for i in 0 1 2 3 4 5 6 7; do
+    printf ' S %x,4\n' $((i * 16))
+done > "$TRACE"
+echo 'X 1' >> "$TRACE"
+for i in 0 1 2 3; do
+    printf ' L %x,4\n' $((i * 16))
+done >> "$TRACE"
+
+# check <expected line> <csim options...> fails unless the output of csim on the trace holds the expected line
+check() {
+    expected=$1
+    shift
+    if ! "$CSIM" "$@" -t "$TRACE" | grep -qx "$expected"; then
+        echo "FAIL csim $*: expected $expected" >&2
+        status=1
+    fi
+}
+
+check 'context_switches:1 lines_flushed:8 flush_writebacks:8' -s 4 -E 1 -b 4 -F full
+check 'hits:0 misses:12 evictions:0' -s 4 -E 1 -b 4 -F full
+check 'tag_misses:12 sector_misses:0 bytes_fetched:48 dirty_sector_writebacks:8' -s 4 -E 1 -b 4 -B 2 -F full
+check 'context_switches:1 lines_flushed:4 flush_writebacks:4' -s 4 -E 1 -b 4 -F partial:50
+check 'context_switches:1 lines_flushed:0 flush_writebacks:0' -s 4 -E 1 -b 4
+
+[ $status -eq 0 ] && echo "flush_writebacks: ok"
+exit $status
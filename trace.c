@@ -0,0 +1,523 @@
+/* trace.c - Reading and writing the memory traces simulated by csim, see trace.h for the formats */
+
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+static unsigned long long get_le(const unsigned char *p, int bytes) {
+    unsigned long long value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+static void put_le(unsigned char *p, unsigned long long value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = value & 0xff;
+        value >>= 8;
+    }
+}
+
+static void fill(trace_reader *r) {
+/* fill moves the bytes not decoded yet to the front of the buffer and reads as many more as fit */
+    memmove(r -> buf, r -> buf + r -> pos, r -> len - r -> pos);
+    r -> len -= r -> pos;
+    r -> pos = 0;
+    size_t n = fread(r -> buf + r -> len, 1, TRACE_READ_BYTES - r -> len, r -> fp);
+    r -> len += n;
+    r -> bytes_read += n;
+    if (n == 0) {
+        r -> eof = 1;
+    }
+}
+
+trace_reader *trace_open_as(const char *path, int format) {
+    FILE *fp = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    trace_reader *r = (trace_reader *)malloc(sizeof(trace_reader));
+    r -> fp = fp;
+    r -> format = format;
+    /* One more byte than is read, to terminate a last line which has no newline */
+    r -> buf = (char *)malloc(TRACE_READ_BYTES + 1);
+    r -> pos = r -> len = r -> eof = r -> malformed = 0;
+    r -> bytes_read = 0;
+    r -> queued = r -> next_queued = 0;
+    /* A trace which does not start with the magic is a text trace, the bytes already read are simply decoded as text */
+    fill(r);
+    if ((format == TRACE_TEXT) || (format == TRACE_BINARY)) {
+        r -> format = TRACE_TEXT;
+        if ((r -> len >= (int)sizeof(TRACE_MAGIC) - 1) &&
+            (memcmp(r -> buf, TRACE_MAGIC, sizeof(TRACE_MAGIC) - 1) == 0)) {
+            r -> format = TRACE_BINARY;
+            r -> pos = sizeof(TRACE_MAGIC) - 1;
+        }
+    }
+    return r;
+}
+
+trace_reader *trace_open(const char *path) {
+    return trace_open_as(path, TRACE_TEXT);
+}
+
+int trace_parse_format(const char *name) {
+    if ((strcmp(name, "text") == 0) || (strcmp(name, "binary") == 0)) {
+        return TRACE_TEXT;
+    } else if (strcmp(name, "din") == 0) {
+        return TRACE_DIN;
+    } else if (strcmp(name, "champsim") == 0) {
+        return TRACE_CHAMPSIM;
+    } else if (strcmp(name, "raw") == 0) {
+        return TRACE_RAW64;
+    }
+    return -1;
+}
+
+static int available(trace_reader *r, int bytes) {
+/* available returns 0 unless the next bytes bytes of the trace are in the buffer */
+    if ((r -> len - r -> pos < bytes) && !r -> eof) {
+        fill(r);
+    }
+    return r -> len - r -> pos >= bytes;
+}
+
+static char *next_line(trace_reader *r) {
+/* next_line returns the next line of the trace terminated by a NUL instead of its newline, or a nullptr at the end */
+    for (;;) {
+        char *line = r -> buf + r -> pos;
+        char *nl = (char *)memchr(line, '\n', r -> len - r -> pos);
+        if (nl != NULL) {
+            r -> pos = nl + 1 - r -> buf;
+        } else if (!r -> eof && ((r -> pos > 0) || (r -> len < TRACE_READ_BYTES))) {
+            fill(r);
+            continue;
+        } else if (r -> pos < r -> len) {
+            /* The last line has no newline, or a line longer than the buffer is cut */
+            nl = r -> buf + r -> len;
+            r -> pos = r -> len;
+        } else {
+            return NULL;
+        }
+        *nl = '\0';
+        return line;
+    }
+}
+
+static void plain_record(trace_record *rec, char type, long long address, int size) {
+    rec -> address = address;
+    rec -> stride = 0;
+    rec -> count = 1;
+    rec -> asid = -1;
+    rec -> size = size;
+    rec -> type = type;
+}
+
+static int parse_text(char *line, trace_record *rec) {
+/* parse_text decodes a line of the text format, terminated by a NUL, and returns 0 if it is not a record. The numbers
+ * are read as scanf would, with " %c %llx , %d , %d" */
+    char *p = line, *end;
+    rec -> stride = 0;
+    rec -> count = 1;
+    rec -> asid = -1;
+    rec -> size = 0;
+
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (*p == '\0') {
+        return 0;
+    }
+    rec -> type = *p++;
+    if ((rec -> type == 'X') || (rec -> type == 'K')) {
+        /* Context switches and TLB shootdowns carry a decimal ASID instead of an address */
+        rec -> asid = (int)strtol(p, &end, 10);
+        rec -> address = rec -> asid;
+        return end != p;
+    }
+    /* Lines which are not records, such as the banner of valgrind, are skipped */
+    rec -> address = (long long)strtoull(p, &end, 16);
+    if (end == p) {
+        return 0;
+    }
+    for (int field = 0; field < 2; field++) {
+        p = end;
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p++ != ',') {
+            break;
+        }
+        int value = (int)strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        if (field == 0) {
+            rec -> size = value;
+        } else {
+            rec -> asid = value;
+        }
+    }
+    return 1;
+}
+
+static int read_text(trace_reader *r, trace_record *rec) {
+    char *line;
+    while ((line = next_line(r)) != NULL) {
+        if (parse_text(line, rec)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int read_binary(trace_reader *r, trace_record *rec) {
+    if (!available(r, TRACE_RECORD_BYTES)) {
+        return 0;
+    }
+    const unsigned char *buf = (const unsigned char *)r -> buf + r -> pos;
+    r -> pos += TRACE_RECORD_BYTES;
+    rec -> address = (long long)get_le(buf, 8);
+    rec -> stride = (long long)get_le(buf + 8, 8);
+    rec -> count = (long long)get_le(buf + 16, 4);
+    rec -> asid = (int)get_le(buf + 20, 4);
+    rec -> size = (int)get_le(buf + 24, 4);
+    rec -> type = (char)buf[28];
+    if (rec -> count == 0) {
+        r -> malformed = 1;
+        return 0;
+    }
+    return 1;
+}
+
+static int read_din(trace_reader *r, trace_record *rec) {
+/* A din line is a label, a hex address and optionally the decimal size of the access. Labels 0, 1 and 2 are reads,
+ * writes and instruction fetches, the escape records 3 and 4 have no equivalent and are skipped */
+    static const char types[] = { 'L', 'S', 'I' };
+    char *line, *p, *end;
+    while ((line = next_line(r)) != NULL) {
+        long label = strtol(line, &p, 10);
+        if ((p == line) || (label < 0) || (label > 2)) {
+            continue;
+        }
+        long long address = (long long)strtoull(p, &end, 16);
+        if (end == p) {
+            continue;
+        }
+        int size = (int)strtol(end, &p, 10);
+        plain_record(rec, types[label], address, (p == end) ? TRACE_DIN_SIZE : size);
+        return 1;
+    }
+    return 0;
+}
+
+static int read_champsim(trace_reader *r, trace_record *rec) {
+/* Every instruction of a ChampSim trace is decoded into its fetch, its loads and its stores, which are queued and
+ * handed out one by one */
+    while (r -> next_queued == r -> queued) {
+        if (!available(r, CHAMPSIM_RECORD_BYTES)) {
+            return 0;
+        }
+        const unsigned char *buf = (const unsigned char *)r -> buf + r -> pos;
+        r -> pos += CHAMPSIM_RECORD_BYTES;
+        r -> queued = r -> next_queued = 0;
+        plain_record(&r -> queue[r -> queued++], 'I', (long long)get_le(buf, 8), CHAMPSIM_FETCH_SIZE);
+        for (int i = 0; i < 4; i++) {
+            long long address = (long long)get_le(buf + 32 + 8*i, 8);
+            if (address != 0) {
+                plain_record(&r -> queue[r -> queued++], 'L', address, CHAMPSIM_ACCESS_SIZE);
+            }
+        }
+        for (int i = 0; i < 2; i++) {
+            long long address = (long long)get_le(buf + 16 + 8*i, 8);
+            if (address != 0) {
+                plain_record(&r -> queue[r -> queued++], 'S', address, CHAMPSIM_ACCESS_SIZE);
+            }
+        }
+    }
+    *rec = r -> queue[r -> next_queued++];
+    return 1;
+}
+
+static int read_raw(trace_reader *r, trace_record *rec) {
+    if (!available(r, 8)) {
+        return 0;
+    }
+    plain_record(rec, 'L', (long long)get_le((const unsigned char *)r -> buf + r -> pos, 8), 8);
+    r -> pos += 8;
+    return 1;
+}
+
+int trace_read(trace_reader *r, trace_record *rec) {
+    switch (r -> format) {
+        case TRACE_BINARY:
+            return read_binary(r, rec);
+        case TRACE_DIN:
+            return read_din(r, rec);
+        case TRACE_CHAMPSIM:
+            return read_champsim(r, rec);
+        case TRACE_RAW64:
+            return read_raw(r, rec);
+    }
+    return read_text(r, rec);
+}
+
+int trace_read_group(trace_reader *r, const trace_record *group, trace_record members[]) {
+    if ((group -> size < 1) || (group -> size > TRACE_MAX_GROUP)) {
+        r -> malformed = 1;
+        return 0;
+    }
+    for (int i = 0; i < group -> size; i++) {
+        if (!trace_read(r, &members[i]) || (members[i].count != 1)) {
+            r -> malformed = 1;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void trace_accesses_init(trace_accesses *a, trace_reader *r) {
+    memset(a, 0, sizeof(*a));
+    a -> reader = r;
+}
+
+int trace_next_access(trace_accesses *a, trace_record *rec) {
+    while (a -> repetition >= a -> count) {
+        trace_record in;
+        if (!trace_read(a -> reader, &in)) {
+            return 0;
+        }
+        if (in.type == 'R') {
+            if (!trace_read_group(a -> reader, &in, a -> members)) {
+                return 0;
+            }
+            a -> p = in.size;
+        } else {
+            a -> members[0] = in;
+            a -> p = 1;
+        }
+        a -> count = in.count;
+        a -> repetition = 0;
+        a -> member = 0;
+    }
+
+    *rec = a -> members[a -> member];
+    rec -> address += a -> repetition * rec -> stride;
+    rec -> stride = 0;
+    rec -> count = 1;
+    if (++a -> member == a -> p) {
+        a -> member = 0;
+        a -> repetition++;
+    }
+    return 1;
+}
+
+int trace_read_into(trace_reader *r, trace_record **recs, long long *capacity, trace_grow_fn grow, long long *n,
+                    long long *accesses) {
+    trace_record rec;
+    *n = *accesses = 0;
+    while (trace_read(r, &rec)) {
+        /* Room for a group and its members */
+        if (*n + 1 + TRACE_MAX_GROUP > *capacity) {
+            trace_record *grown = grow(*recs, *capacity, 2 * *capacity);
+            if (grown == NULL) {
+                return 0;
+            }
+            *recs = grown;
+            *capacity *= 2;
+        }
+        (*recs)[(*n)++] = rec;
+        if (rec.type == 'R') {
+            if (!trace_read_group(r, &rec, &(*recs)[*n])) {
+                return 0;
+            }
+            *n += rec.size;
+            *accesses += rec.size * rec.count;
+        } else if ((rec.type != 'X') && (rec.type != 'K')) {
+            *accesses += rec.count;
+        }
+    }
+    return !r -> malformed;
+}
+
+static trace_record *grow_heap(trace_record *recs, long long capacity, long long new_capacity) {
+    (void)capacity;
+    return (trace_record *)realloc(recs, new_capacity * sizeof(trace_record));
+}
+
+trace_record *trace_read_all(trace_reader *r, long long *n, long long *accesses) {
+    long long capacity = 1 << 16;
+    trace_record *recs = (trace_record *)malloc(capacity * sizeof(trace_record));
+    *n = *accesses = 0;
+    if ((recs != NULL) && !trace_read_into(r, &recs, &capacity, grow_heap, n, accesses)) {
+        free(recs);
+        return NULL;
+    }
+    return recs;
+}
+
+void trace_close(trace_reader *r) {
+    if (r -> fp != stdin) {
+        fclose(r -> fp);
+    }
+    free(r -> buf);
+    free(r);
+}
+
+static void flush_writer(trace_writer *w) {
+    if (fwrite(w -> buf, 1, w -> len, w -> fp) != (size_t)w -> len) {
+        w -> failed = 1;
+    }
+    w -> len = 0;
+}
+
+static char *reserve(trace_writer *w, int bytes) {
+/* reserve returns where the next bytes bytes of output go, writing the buffer out first if they do not fit */
+    if (w -> len + bytes > TRACE_WRITE_BYTES) {
+        flush_writer(w);
+    }
+    return w -> buf + w -> len;
+}
+
+static char *put_hex(char *p, unsigned long long value) {
+    char digits[16];
+    int n = 0;
+    do {
+        digits[n++] = "0123456789abcdef"[value & 0xf];
+        value >>= 4;
+    } while (value);
+    while (n) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+static char *put_dec(char *p, int value) {
+    char digits[10];
+    int n = 0;
+    unsigned int u = (value < 0) ? 0u - (unsigned int)value : (unsigned int)value;
+    if (value < 0) {
+        *p++ = '-';
+    }
+    do {
+        digits[n++] = '0' + u % 10;
+        u /= 10;
+    } while (u);
+    while (n) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+trace_writer *trace_create(const char *path, int format) {
+    FILE *fp = (strcmp(path, "-") == 0) ? stdout : fopen(path, "wb");
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    trace_writer *w = (trace_writer *)malloc(sizeof(trace_writer));
+    w -> fp = fp;
+    w -> format = format;
+    w -> records = 0;
+    w -> buf = (char *)malloc(TRACE_WRITE_BYTES);
+    w -> len = 0;
+    w -> failed = 0;
+    if (format == TRACE_BINARY) {
+        memcpy(w -> buf, TRACE_MAGIC, sizeof(TRACE_MAGIC) - 1);
+        w -> len = sizeof(TRACE_MAGIC) - 1;
+    }
+    return w;
+}
+
+int trace_write(trace_writer *w, const trace_record *rec) {
+    w -> records++;
+    if (w -> format == TRACE_BINARY) {
+        unsigned char *buf = (unsigned char *)reserve(w, TRACE_RECORD_BYTES);
+        put_le(buf, (unsigned long long)rec -> address, 8);
+        put_le(buf + 8, (unsigned long long)rec -> stride, 8);
+        put_le(buf + 16, (unsigned long long)rec -> count, 4);
+        put_le(buf + 20, (unsigned long long)(unsigned int)rec -> asid, 4);
+        put_le(buf + 24, (unsigned long long)rec -> size, 4);
+        buf[28] = (unsigned char)rec -> type;
+        buf[29] = buf[30] = buf[31] = 0;
+        w -> len += TRACE_RECORD_BYTES;
+        return !w -> failed;
+    }
+
+    /* Formatted as "%c %d\n" for context switches and shootdowns and as " %c %llx,%d[,%d]\n" for accesses, but without
+     * the cost of printf */
+    char *start = reserve(w, TRACE_MAX_LINE), *p = start;
+    if ((rec -> type == 'X') || (rec -> type == 'K')) {
+        *p++ = rec -> type;
+        *p++ = ' ';
+        p = put_dec(p, rec -> asid);
+        *p++ = '\n';
+        w -> len += p - start;
+        return !w -> failed;
+    }
+    /* The text format has no runs, they are written out access by access. Instruction fetches are not indented, as
+     * in the output of lackey */
+    for (long long i = 0; i < rec -> count; i++) {
+        start = p = reserve(w, TRACE_MAX_LINE);
+        if (rec -> type != 'I') {
+            *p++ = ' ';
+        }
+        *p++ = rec -> type;
+        *p++ = ' ';
+        p = put_hex(p, (unsigned long long)(rec -> address + i * rec -> stride));
+        *p++ = ',';
+        p = put_dec(p, rec -> size);
+        if (rec -> asid >= 0) {
+            *p++ = ',';
+            p = put_dec(p, rec -> asid);
+        }
+        *p++ = '\n';
+        w -> len += p - start;
+    }
+    return !w -> failed;
+}
+
+int trace_write_group(trace_writer *w, const trace_record members[], int p, long long count) {
+    if (w -> format == TRACE_BINARY) {
+        trace_record group;
+        memset(&group, 0, sizeof(group));
+        group.type = 'R';
+        group.count = count;
+        group.size = p;
+        group.asid = -1;
+        if (!trace_write(w, &group)) {
+            return 0;
+        }
+        for (int i = 0; i < p; i++) {
+            if (!trace_write(w, &members[i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+
+    /* The repetitions are written out one by one in the text format */
+    for (long long k = 0; k < count; k++) {
+        for (int i = 0; i < p; i++) {
+            trace_record rec = members[i];
+            rec.address += k * rec.stride;
+            rec.count = 1;
+            if (!trace_write(w, &rec)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+int trace_finish(trace_writer *w) {
+    flush_writer(w);
+    int ok = !ferror(w -> fp) && !w -> failed;
+    ok = (((w -> fp == stdout) ? fflush(w -> fp) : fclose(w -> fp)) == 0) && ok;
+    free(w -> buf);
+    free(w);
+    return ok;
+}
@@ -0,0 +1,137 @@
+/* trace.h - Reading and writing the memory traces simulated by csim
+ *
+ * Traces come either in the text format of valgrind's lackey tool (" L 7ff000a0,8"), extended with the records
+ * described in csim.c, or in the binary format of csim. A binary trace starts with the 8 byte magic TRACE_MAGIC
+ * followed by fixed size records of TRACE_RECORD_BYTES bytes, all fields little-endian:
+ *   offset  0  address  64 bits
+ *   offset  8  stride   64 bits, signed
+ *   offset 16  count    32 bits
+ *   offset 20  asid     32 bits, signed, -1 when the record carries none
+ *   offset 24  size     32 bits
+ *   offset 28  type     8 bits, the record letter of the text format
+ *   offset 29  padding  3 bytes
+ *
+ * A record with a count above 1 is a run: count accesses of the same type and size at address, address + stride,
+ * address + 2*stride ... Interleaved runs, such as the loads from A and the stores to B of a transpose, are described
+ * by a group: an 'R' record whose size is the number of members p and whose count is the number of repetitions,
+ * followed by p member records with a count of 1. Repetition k accesses address + k*stride of every member, in the
+ * order of the members. A record with a count of 0 describes no access and is malformed. Runs and groups are
+ * produced by tracezip and let csim simulate regular access patterns without decoding every single access.
+ *
+ * Traces of other tools are read with trace_open_as and decoded into the same records, so that everything reading
+ * traces accepts them as they are:
+ *   din       the text format of DineroIV, "<label> <hex address> [<size>]" with the labels 0 (read), 1 (write) and
+ *             2 (instruction fetch)
+ *   champsim  the binary traces of ChampSim, one CHAMPSIM_RECORD_BYTES byte record per instruction giving its address,
+ *             its registers and the addresses of up to 2 stores and 4 loads, 0 for the unused ones
+ *   raw       a bare stream of little-endian 64-bit addresses, all of them loads of 8 bytes
+ * Neither ChampSim nor DineroIV traces need to give the size of an access, the sizes below are used instead. */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+
+#define TRACE_MAGIC "CSIMTRC1"
+#define TRACE_RECORD_BYTES 32
+/* The longest run a single record can describe */
+#define TRACE_MAX_COUNT 0xffffffffLL
+/* The largest number of members of a group */
+#define TRACE_MAX_GROUP 8
+/* Size of the reads issued on a trace. Traces are read front to back and never seeked, so that they can be pipes */
+#define TRACE_READ_BYTES (1 << 20)
+/* Size of the writes issued on a trace */
+#define TRACE_WRITE_BYTES (1 << 20)
+/* The longest line of the text format written */
+#define TRACE_MAX_LINE 64
+
+#define CHAMPSIM_RECORD_BYTES 64
+#define CHAMPSIM_FETCH_SIZE 4
+#define CHAMPSIM_ACCESS_SIZE 8
+#define TRACE_DIN_SIZE 4
+
+enum trace_format { TRACE_TEXT, TRACE_BINARY, TRACE_DIN, TRACE_CHAMPSIM, TRACE_RAW64 };
+
+typedef struct {
+    long long address;
+    long long stride;
+    long long count;
+    int asid;
+    int size;
+    char type;
+} trace_record;
+
+typedef struct {
+    FILE *fp;
+    int format;
+    /* The bytes read which have not been decoded yet are buf[pos, len) */
+    char *buf;
+    int pos, len, eof;
+    /* Set when the reading stopped at a malformed record or group rather than at the end of the trace */
+    int malformed;
+    long long bytes_read;
+    /* The accesses of a ChampSim instruction which have not been handed out yet are queue[next_queued, queued) */
+    trace_record queue[7];
+    int queued, next_queued;
+} trace_reader;
+
+typedef struct {
+    FILE *fp;
+    int format;
+    long long records;
+    /* The output not written yet, and whether any write failed */
+    char *buf;
+    int len, failed;
+} trace_writer;
+
+/* A grow function returns the capacity records of recs moved to a block of new_capacity records, or a nullptr, leaving
+ * recs in place, if there is no room */
+typedef trace_record *(*trace_grow_fn)(trace_record *recs, long long capacity, long long new_capacity);
+
+/* The accesses of a trace one at a time, its runs and groups expanded into single records */
+typedef struct {
+    trace_reader *reader;
+    trace_record members[TRACE_MAX_GROUP];
+    int p, member;
+    long long repetition, count;
+} trace_accesses;
+
+/* trace_open opens a trace in either format, or standard input if path is "-", and returns a nullptr if it cannot be
+ * read */
+trace_reader *trace_open(const char *path);
+/* trace_open_as opens a trace of the given format, where TRACE_TEXT and TRACE_BINARY both detect either of them */
+trace_reader *trace_open_as(const char *path, int format);
+/* trace_parse_format returns the format called name, text, binary, din, champsim or raw, and -1 for any other name */
+int trace_parse_format(const char *name);
+/* trace_read stores the next record of the trace in rec and returns 0 at the end of the trace, or at a malformed record
+ * with r -> malformed set */
+int trace_read(trace_reader *r, trace_record *rec);
+/* trace_read_group reads the members of the group whose 'R' record was just read and returns 0, with r -> malformed
+ * set, if the trace ends before all of them or the group is malformed */
+int trace_read_group(trace_reader *r, const trace_record *group, trace_record members[]);
+/* trace_read_all reads the rest of the trace into an array allocated with malloc, the members of every group right
+ * after its 'R' record, stores the number of records in n and of the accesses they describe in accesses, and returns
+ * a nullptr if the trace is malformed or does not fit in memory */
+trace_record *trace_read_all(trace_reader *r, long long *n, long long *accesses);
+/* trace_read_into reads the rest of the trace as trace_read_all does, into the capacity records of recs, which grow
+ * moves to a larger block when they are full and returns 0 if the trace is malformed or grow returns a nullptr, recs
+ * and capacity always describing the block in use */
+int trace_read_into(trace_reader *r, trace_record **recs, long long *capacity, trace_grow_fn grow, long long *n,
+                    long long *accesses);
+void trace_close(trace_reader *r);
+/* trace_accesses_init starts handing out the accesses of the rest of the trace r, which may be a nullptr */
+void trace_accesses_init(trace_accesses *a, trace_reader *r);
+/* trace_next_access stores the next access of the trace in rec, with a count of 1, and returns 0 at the end of the
+ * trace or at a malformed record or group, which sets malformed in the reader */
+int trace_next_access(trace_accesses *a, trace_record *rec);
+
+/* trace_create creates a trace of the given format, or writes it to standard output if path is "-", and returns a
+ * nullptr if it cannot be written */
+trace_writer *trace_create(const char *path, int format);
+int trace_write(trace_writer *w, const trace_record *rec);
+/* trace_write_group writes count repetitions of the p interleaved members */
+int trace_write_group(trace_writer *w, const trace_record members[], int p, long long count);
+/* trace_finish flushes and closes the trace and returns 0 if any write failed */
+int trace_finish(trace_writer *w);
+
+#endif
@@ -0,0 +1,191 @@
+/* tracerec.c - Records the loads and stores of a program compiled with clang's sanitizer coverage, see tracerec.h
+ *
+ * This file must not be compiled with -fsanitize-coverage itself, the callbacks would trace their own accesses. */
+
+#include "tracerec.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+/* The records of one thread which have not been handed over yet. The buffers of the live threads are chained so that
+ * tracerec_stop can reach them */
+typedef struct thread_buffer {
+    trace_record recs[TRACEREC_BUFFER];
+    int n;
+    struct thread_buffer *prev, *next;
+} thread_buffer;
+
+static volatile int recording;
+static int num_ranges;
+static uintptr_t range_lo[TRACEREC_MAX_RANGES], range_hi[TRACEREC_MAX_RANGES];
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t buffer_key;
+static thread_buffer *buffers;
+static __thread thread_buffer *own_buffer;
+
+static trace_writer *writer;
+static int write_ok = 1;
+static tracerec_sink sink;
+static void *sink_arg;
+
+static void hand_over(thread_buffer *tb) {
+/* hand_over passes the records of tb to the output, the caller holds the lock */
+    if (tb -> n == 0) {
+        return;
+    }
+    if (sink != NULL) {
+        sink(sink_arg, tb -> recs, tb -> n);
+    } else if (writer != NULL) {
+        for (int i = 0; i < tb -> n; i++) {
+            write_ok = trace_write(writer, &tb -> recs[i]) && write_ok;
+        }
+    }
+    tb -> n = 0;
+}
+
+static void thread_exit(void *arg) {
+/* thread_exit hands over the last records of an exiting thread and releases its buffer */
+    thread_buffer *tb = (thread_buffer *)arg;
+    pthread_mutex_lock(&lock);
+    hand_over(tb);
+    if (tb -> prev != NULL) {
+        tb -> prev -> next = tb -> next;
+    } else {
+        buffers = tb -> next;
+    }
+    if (tb -> next != NULL) {
+        tb -> next -> prev = tb -> prev;
+    }
+    pthread_mutex_unlock(&lock);
+    own_buffer = NULL;
+    free(tb);
+}
+
+static void create_key(void) {
+    pthread_key_create(&buffer_key, thread_exit);
+}
+
+static thread_buffer *new_buffer(void) {
+    thread_buffer *tb = (thread_buffer *)malloc(sizeof(thread_buffer));
+    tb -> n = 0;
+    tb -> prev = NULL;
+    pthread_once(&key_once, create_key);
+    pthread_setspecific(buffer_key, tb);
+
+    pthread_mutex_lock(&lock);
+    tb -> next = buffers;
+    if (buffers != NULL) {
+        buffers -> prev = tb;
+    }
+    buffers = tb;
+    pthread_mutex_unlock(&lock);
+    return tb;
+}
+
+static void record(const void *addr, int size, char type) {
+/* record appends an access of the calling thread if it is recorded */
+    uintptr_t a = (uintptr_t)addr;
+    if (!recording) {
+        return;
+    }
+    if (num_ranges) {
+        int i = 0;
+        while ((i < num_ranges) && ((a < range_lo[i]) || (a >= range_hi[i]))) {
+            i++;
+        }
+        if (i == num_ranges) {
+            return;
+        }
+    }
+
+    thread_buffer *tb = own_buffer;
+    if (tb == NULL) {
+        tb = own_buffer = new_buffer();
+    }
+    if (tb -> n > 0) {
+        /* A read-modify-write of a single location is a modify, as lackey reports it */
+        trace_record *last = &tb -> recs[tb -> n - 1];
+        if ((type == 'S') && (last -> type == 'L') && (last -> address == (long long)a) && (last -> size == size)) {
+            last -> type = 'M';
+            return;
+        }
+    }
+    if (tb -> n == TRACEREC_BUFFER) {
+        pthread_mutex_lock(&lock);
+        hand_over(tb);
+        pthread_mutex_unlock(&lock);
+    }
+
+    trace_record *rec = &tb -> recs[tb -> n++];
+    rec -> address = (long long)a;
+    rec -> stride = 0;
+    rec -> count = 1;
+    rec -> asid = -1;
+    rec -> size = size;
+    rec -> type = type;
+}
+
+/* The callbacks inserted by -fsanitize-coverage=trace-loads,trace-stores */
+void __sanitizer_cov_load1(uint8_t *addr) { record(addr, 1, 'L'); }
+void __sanitizer_cov_load2(uint16_t *addr) { record(addr, 2, 'L'); }
+void __sanitizer_cov_load4(uint32_t *addr) { record(addr, 4, 'L'); }
+void __sanitizer_cov_load8(uint64_t *addr) { record(addr, 8, 'L'); }
+void __sanitizer_cov_load16(void *addr) { record(addr, 16, 'L'); }
+void __sanitizer_cov_store1(uint8_t *addr) { record(addr, 1, 'S'); }
+void __sanitizer_cov_store2(uint16_t *addr) { record(addr, 2, 'S'); }
+void __sanitizer_cov_store4(uint32_t *addr) { record(addr, 4, 'S'); }
+void __sanitizer_cov_store8(uint64_t *addr) { record(addr, 8, 'S'); }
+void __sanitizer_cov_store16(void *addr) { record(addr, 16, 'S'); }
+
+int tracerec_open(const char *path, int format) {
+    writer = trace_create(path, format);
+    write_ok = 1;
+    sink = NULL;
+    return writer != NULL;
+}
+
+void tracerec_set_sink(tracerec_sink fn, void *arg) {
+    sink = fn;
+    sink_arg = arg;
+}
+
+int tracerec_range(const void *lo, const void *hi) {
+    if (num_ranges == TRACEREC_MAX_RANGES) {
+        return 0;
+    }
+    range_lo[num_ranges] = (uintptr_t)lo;
+    range_hi[num_ranges] = (uintptr_t)hi;
+    num_ranges++;
+    return 1;
+}
+
+void tracerec_clear_ranges(void) {
+    num_ranges = 0;
+}
+
+void tracerec_start(void) {
+    recording = 1;
+}
+
+void tracerec_stop(void) {
+/* The threads which are still recording must have finished their accesses, their buffers are emptied here */
+    recording = 0;
+    pthread_mutex_lock(&lock);
+    for (thread_buffer *tb = buffers; tb != NULL; tb = tb -> next) {
+        hand_over(tb);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+int tracerec_close(void) {
+    int ok = 1;
+    tracerec_stop();
+    if (writer != NULL) {
+        ok = trace_finish(writer) && write_ok;
+        writer = NULL;
+    }
+    return ok;
+}
@@ -0,0 +1,44 @@
+/* tracerec.h - Records the loads and stores of a program compiled with clang's
+ * -fsanitize-coverage=trace-loads,trace-stores, without running it under valgrind.
+ *
+ * The compiler calls __sanitizer_cov_load<n> and __sanitizer_cov_store<n> before every load and store of the
+ * instrumented files, which tracerec.c turns into trace records. Only the files whose accesses should be traced are
+ * compiled with the flag, tracerec.c and the simulator itself never are. Recording is off until tracerec_start and only
+ * keeps the accesses falling in one of the ranges given to tracerec_range, or every access if no range was given.
+ *
+ * Every thread appends its records to a buffer of its own, which is handed to the output when it fills up, when the
+ * thread exits and on tracerec_stop. The output is either a trace file (tracerec_open) or a function called with the
+ * records in the program, typically to simulate them right away (tracerec_set_sink). Buffers are handed over under a
+ * lock, so the accesses of one thread keep their order while those of different threads are interleaved a buffer at a
+ * time. A load immediately followed by a store of the same address and size becomes an 'M' record, as in the traces
+ * of valgrind's lackey tool.
+ *
+ * Build the traced code with : clang -O0 -g -fsanitize-coverage=trace-loads,trace-stores -c file.c
+ * and link it with tracerec.c trace.c and -pthread. */
+
+#ifndef TRACEREC_H
+#define TRACEREC_H
+
+#include "trace.h"
+
+/* The number of records a thread collects before handing them over */
+#define TRACEREC_BUFFER 4096
+/* The largest number of address ranges recorded */
+#define TRACEREC_MAX_RANGES 8
+
+typedef void (*tracerec_sink)(void *arg, const trace_record recs[], int n);
+
+/* tracerec_open sends the records to a new trace of the given format and returns 0 if it cannot be written */
+int tracerec_open(const char *path, int format);
+/* tracerec_set_sink sends the records to sink instead, which is never called by two threads at the same time */
+void tracerec_set_sink(tracerec_sink sink, void *arg);
+/* tracerec_range restricts recording to the accesses starting in [lo, hi), along with the other ranges given */
+int tracerec_range(const void *lo, const void *hi);
+void tracerec_clear_ranges(void);
+void tracerec_start(void);
+/* tracerec_stop stops recording and hands over the records of every thread */
+void tracerec_stop(void);
+/* tracerec_close stops recording, closes the trace opened by tracerec_open and returns 0 if any write failed */
+int tracerec_close(void);
+
+#endif
@@ -0,0 +1,370 @@
+/* tracereplay.c - Replays the loads and stores of a trace on the host, to check that what csim predicts to be faster
+ * really is faster on the hardware without rebuilding the program which was traced.
+ * Required inputs : the trace to replay (-t)
+ *
+ * The trace is decoded into a flat list of accesses first, runs and groups expanded, and the addresses are remapped
+ * into a buffer allocated for the replay. When the addresses of the trace span at most -m MB, they keep their distances
+ * and their offsets within REPLAY_ALIGN bytes, so that the accesses fall into the same sets of the L1 cache as in the
+ * program. Traces spread wider, such as those mixing the stack and the heap, get their pages packed side by side in the
+ * order of their addresses, which keeps the offsets within the pages.
+ *
+ * Every access is then performed on the buffer with its size: loads (L), stores (S and N), both (M), software prefetches
+ * (P) and, on x86, clflush (F). Instruction fetches and the other records are skipped. By default the loads are
+ * independent and the replay measures the throughput of the memory system. With -d each address depends on the value
+ * loaded before it, as in a pointer chase, so that the latencies add up. Each of the -r replays starts from empty
+ * caches unless -w is given, in which case a first untimed replay warms them. The fastest replay and the smallest
+ * counts of the hardware counters (see hostperf.h) are reported as one line of key:value pairs:
+ *   replay trace:t64.trace accesses:16384 loads:8192 stores:8192 skipped:0 footprint_kb:40 span_kb:272 remap:linear
+ *          mode:throughput runs:5 seconds:0.000041 ns_per_access:2.5 l1d_hw:4620 llc_hw:1090 dtlb_hw:70
+ * all on one line, with n/a for the counters which cannot be opened.
+ *
+ * Build with : gcc -g -Wall -Werror -std=c99 -m64 -O2 -o tracereplay tracereplay.c hostperf.c trace.c */
+
+#define _DEFAULT_SOURCE
+#include "trace.h"
+#include "hostperf.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <string.h>
+
+/* The alignment of the replay buffer, the offsets of the accesses within it are those of the trace */
+#define REPLAY_ALIGN (2 << 20)
+#define REPLAY_PAGE 4096
+#define DEFAULT_SPAN_MB 1024
+
+/* An access of the replay, at offset bytes into the buffer */
+typedef struct {
+    long long offset;
+    int size;
+    char type;
+} replay_op;
+
+long long remap_pages(replay_op ops[], long long n, long long *pages);
+int compare_pages(const void *a, const void *b);
+void replay(char *buffer, const replay_op ops[], long long n, int dependent);
+void usage(char *argv[]);
+
+/* Always 0, read at run time so that the compiler cannot tell that the chained addresses do not change */
+volatile long long chain_mask;
+/* The sum of the values loaded, so that the loads cannot be optimized away */
+volatile unsigned long long replay_sink;
+
+int main(int argc, char *argv[]) {
+    extern char* optarg;
+    char *trace_file = NULL;
+    int c, err_flag = 0, format = TRACE_TEXT, runs = 5, dependent = 0, warm = 0;
+    long long limit = -1, span_mb = DEFAULT_SPAN_MB;
+
+    while((c = getopt(argc, argv, "t:f:r:n:m:dwh")) != -1) {
+        switch(c) {
+            case 't':
+                trace_file = optarg;
+                break;
+            case 'f':
+                format = trace_parse_format(optarg);
+                if (format < 0) {
+                    err_flag = 1;
+                }
+                break;
+            case 'r':
+                runs = atoi(optarg);
+                break;
+            case 'n':
+                limit = atoll(optarg);
+                break;
+            case 'm':
+                span_mb = atoll(optarg);
+                break;
+            case 'd':
+                dependent = 1;
+                break;
+            case 'w':
+                warm = 1;
+                break;
+            case 'h':
+                usage(argv);
+                return 0;
+            default:
+                err_flag = 1;
+                break;
+        }
+    }
+    if ((trace_file == NULL) || (runs <= 0) || (span_mb <= 0) || err_flag) {
+        usage(argv);
+        return -1;
+    }
+
+    trace_accesses src;
+    trace_accesses_init(&src, trace_open_as(trace_file, format));
+    if (src.reader == NULL) {
+        fprintf(stderr, "could not open %s\n", trace_file);
+        return -2;
+    }
+
+    /* The accesses with their addresses, turned into offsets below */
+    long long n = 0, capacity = 1 << 16, loads = 0, stores = 0, skipped = 0;
+    long long lowest = 0, highest = 0;
+    replay_op *ops = (replay_op *)malloc(capacity * sizeof(replay_op));
+    trace_record rec;
+    while (((limit < 0) || (n < limit)) && (ops != NULL) && trace_next_access(&src, &rec)) {
+        if ((rec.type != 'L') && (rec.type != 'S') && (rec.type != 'M') && (rec.type != 'N') && (rec.type != 'P') &&
+            (rec.type != 'F')) {
+            skipped++;
+            continue;
+        }
+        if (n == capacity) {
+            capacity *= 2;
+            ops = (replay_op *)realloc(ops, capacity * sizeof(replay_op));
+            if (ops == NULL) {
+                break;
+            }
+        }
+        int size = (rec.size > 0) ? rec.size : 1;
+        if ((n == 0) || (rec.address < lowest)) {
+            lowest = rec.address;
+        }
+        if ((n == 0) || (rec.address + size > highest)) {
+            highest = rec.address + size;
+        }
+        loads += (rec.type == 'L') || (rec.type == 'M');
+        stores += (rec.type == 'S') || (rec.type == 'M') || (rec.type == 'N');
+        ops[n].offset = rec.address;
+        ops[n].size = size;
+        ops[n].type = rec.type;
+        n++;
+    }
+    trace_close(src.reader);
+    if (ops == NULL) {
+        fprintf(stderr, "could not allocate the accesses of %s\n", trace_file);
+        return -2;
+    }
+    if (n == 0) {
+        fprintf(stderr, "%s has no access to replay\n", trace_file);
+        return -2;
+    }
+
+    long long base = lowest & ~(long long)(REPLAY_ALIGN - 1), pages;
+    long long span = highest - base, bytes;
+    int linear = (span <= (span_mb << 20));
+    pages = remap_pages(ops, n, NULL);
+    if (linear) {
+        for (long long i = 0; i < n; i++) {
+            ops[i].offset -= base;
+        }
+        bytes = span;
+    } else {
+        long long *page_list = (long long *)malloc(pages * sizeof(long long));
+        if (page_list == NULL) {
+            fprintf(stderr, "could not allocate %lld pages\n", pages);
+            return -2;
+        }
+        remap_pages(ops, n, page_list);
+        free(page_list);
+        /* An access straddling the end of its page reaches into the page packed after it, or the spare last page */
+        bytes = (pages + 1) * REPLAY_PAGE;
+    }
+
+    char *buffer = NULL;
+    if (posix_memalign((void **)&buffer, REPLAY_ALIGN, bytes + 64) != 0) {
+        fprintf(stderr, "could not allocate %lld bytes\n", bytes);
+        return -2;
+    }
+    memset(buffer, 0, bytes + 64);
+    size_t flush_bytes = hostperf_flush_bytes();
+    char *flush_buffer = warm ? NULL : (char *)malloc(flush_bytes);
+    if (!warm && (flush_buffer == NULL)) {
+        fprintf(stderr, "could not allocate %zu bytes\n", flush_bytes);
+        return -2;
+    }
+    if (!warm) {
+        memset(flush_buffer, 0, flush_bytes);
+    }
+
+    hostperf hp;
+    int measured = hostperf_open(&hp);
+    long long best[HOSTPERF_METRICS];
+    double best_seconds = 0;
+    if (warm) {
+        replay(buffer, ops, n, dependent);
+    }
+    for (int r = 0; r < runs; r++) {
+        long long values[HOSTPERF_METRICS];
+        if (!warm) {
+            hostperf_flush(flush_buffer, flush_bytes);
+        }
+        double start = hostperf_seconds();
+        hostperf_enable(&hp, 1);
+        replay(buffer, ops, n, dependent);
+        hostperf_enable(&hp, 0);
+        double seconds = hostperf_seconds() - start;
+        hostperf_read(&hp, values);
+        for (int k = 0; k < HOSTPERF_METRICS; k++) {
+            best[k] = ((r == 0) || (values[k] < best[k])) ? values[k] : best[k];
+        }
+        best_seconds = ((r == 0) || (seconds < best_seconds)) ? seconds : best_seconds;
+    }
+
+    printf("replay trace:%s accesses:%lld loads:%lld stores:%lld skipped:%lld footprint_kb:%lld span_kb:%lld "
+           "remap:%s mode:%s runs:%d seconds:%.6f ns_per_access:%.1f", trace_file, n, loads, stores, skipped,
+           pages * REPLAY_PAGE / 1024, (highest - lowest + 1023) / 1024, linear ? "linear" : "pages",
+           dependent ? "latency" : "throughput", runs, best_seconds, best_seconds * 1e9 / n);
+    for (int k = 0; k < HOSTPERF_METRICS; k++) {
+        if (measured & (1 << k)) {
+            printf(" %s_hw:%lld", hostperf_names[k], best[k]);
+        } else {
+            printf(" %s_hw:n/a", hostperf_names[k]);
+        }
+    }
+    printf("\n");
+
+    hostperf_close(&hp);
+    free(flush_buffer);
+    free(buffer);
+    free(ops);
+    return 0;
+}
+
+long long remap_pages(replay_op ops[], long long n, long long *pages) {
+/* remap_pages returns the number of distinct pages the accesses start in. Given room for them in pages, it also packs
+ * them: the offset of every access becomes the rank of its page times REPLAY_PAGE plus its offset within the page */
+    long long *sorted = (long long *)malloc(n * sizeof(long long)), distinct = 0;
+    if (sorted == NULL) {
+        return 0;
+    }
+    for (long long i = 0; i < n; i++) {
+        sorted[i] = ops[i].offset / REPLAY_PAGE;
+    }
+    qsort(sorted, n, sizeof(long long), compare_pages);
+    for (long long i = 0; i < n; i++) {
+        if ((i == 0) || (sorted[i] != sorted[i - 1])) {
+            sorted[distinct++] = sorted[i];
+        }
+    }
+    if (pages != NULL) {
+        memcpy(pages, sorted, distinct * sizeof(long long));
+        for (long long i = 0; i < n; i++) {
+            long long page = ops[i].offset / REPLAY_PAGE;
+            long long *found = (long long *)bsearch(&page, pages, distinct, sizeof(long long), compare_pages);
+            ops[i].offset = (found - pages) * REPLAY_PAGE + ops[i].offset % REPLAY_PAGE;
+        }
+    }
+    free(sorted);
+    return distinct;
+}
+
+int compare_pages(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static inline unsigned long long load(const char *p, int size) {
+/* load reads size bytes at p, in a single instruction for the sizes up to 8 */
+    uint8_t v1;
+    uint16_t v2;
+    uint32_t v4;
+    uint64_t v8, sum = 0;
+    switch (size) {
+        case 1:
+            memcpy(&v1, p, 1);
+            return v1;
+        case 2:
+            memcpy(&v2, p, 2);
+            return v2;
+        case 4:
+            memcpy(&v4, p, 4);
+            return v4;
+        case 8:
+            memcpy(&v8, p, 8);
+            return v8;
+    }
+    for (int i = 0; i < size; i += 8) {
+        memcpy(&v8, p + i, (size - i < 8) ? size - i : 8);
+        sum += v8;
+    }
+    return sum;
+}
+
+static inline void store(char *p, int size, unsigned long long value) {
+    uint8_t v1 = (uint8_t)value;
+    uint16_t v2 = (uint16_t)value;
+    uint32_t v4 = (uint32_t)value;
+    uint64_t v8 = value;
+    switch (size) {
+        case 1:
+            memcpy(p, &v1, 1);
+            return;
+        case 2:
+            memcpy(p, &v2, 2);
+            return;
+        case 4:
+            memcpy(p, &v4, 4);
+            return;
+        case 8:
+            memcpy(p, &v8, 8);
+            return;
+    }
+    for (int i = 0; i < size; i += 8) {
+        memcpy(p + i, &v8, (size - i < 8) ? size - i : 8);
+    }
+}
+
+static inline void replay_ops(char *buffer, const replay_op ops[], long long n, int dependent) {
+/* replay_ops performs the accesses. It is inlined once for each mode so that the independent replay does not carry
+ * the chain of the dependent one */
+    unsigned long long sum = 0;
+    long long chain = 0, mask = chain_mask;
+    for (long long i = 0; i < n; i++) {
+        char *p = buffer + ops[i].offset + chain;
+        unsigned long long value;
+        switch (ops[i].type) {
+            case 'L':
+                value = load(p, ops[i].size);
+                sum += value;
+                chain = dependent ? (long long)(value & mask) : 0;
+                break;
+            case 'M':
+                value = load(p, ops[i].size);
+                store(p, ops[i].size, value + 1);
+                chain = dependent ? (long long)(value & mask) : 0;
+                break;
+            case 'S':
+            case 'N':
+                store(p, ops[i].size, i);
+                break;
+            case 'P':
+                __builtin_prefetch(p);
+                break;
+            case 'F':
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_clflush(p);
+#endif
+                break;
+        }
+    }
+    replay_sink += sum;
+}
+
+void replay(char *buffer, const replay_op ops[], long long n, int dependent) {
+    if (dependent) {
+        replay_ops(buffer, ops, n, 1);
+    } else {
+        replay_ops(buffer, ops, n, 0);
+    }
+}
+
+void usage(char *argv[]) {
+    printf("%s [-hdw] -t <file> [-f <fmt>] [-r <num>] [-n <num>] [-m <MB>]\n", argv[0]);
+    printf("\nOptions:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -t <file>  Trace to replay, - for standard input.\n");
+    printf("  -f <fmt>   Format of the trace : text or binary (detected), din, champsim or raw.\n");
+    printf("  -r <num>   Number of timed replays, the fastest is reported (default 5).\n");
+    printf("  -n <num>   Replay only the first <num> accesses.\n");
+    printf("  -m <MB>    Largest span of addresses replayed at their distances, wider traces have their pages\n");
+    printf("             packed (default %d).\n", DEFAULT_SPAN_MB);
+    printf("  -d         Make every address depend on the previous load, to measure latency.\n");
+    printf("  -w         Replay on warm caches instead of emptying them before every replay.\n");
+    printf("\nExample : %s -t traces/trans.trace -r 10\n", argv[0]);
+}
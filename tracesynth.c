@@ -0,0 +1,344 @@
+/* tracesynth.c - Generates synthetic traces, reproducible workloads to benchmark and test csim with.
+ * Required inputs : the access pattern (-p) and the output file (-o)
+ *
+ * The patterns are
+ *   seq       accesses of -l bytes one after the other
+ *   stride    accesses -k bytes apart
+ *   random    uniformly random items of -k bytes
+ *   zipf      items of -k bytes drawn from a Zipf distribution of exponent -e, the most popular items scattered over
+ *             the footprint
+ *   chase     a pointer chase through a random cycle over all the items, each load giving the next item
+ *   trans, blocking, submit
+ *             the accesses to A and B of trans, transpose_blocking and transpose_submit of trans.c on N*M matrices.
+ *             The transposes themselves are run through trans_sim_write (see transsim.h), so the trace follows trans.c
+ *             as it is, with A at -a and B after it as in the driver of the assignment. -B replaces blocking and submit
+ *             by transpose_tiled on square tiles of that side, submit copying the diagonal last
+ * The first five patterns stay within a footprint of -f bytes starting at -a, wrapping around or, for random, zipf
+ * and chase, rounding the number of items up to a power of two. They make -n accesses, of which -w percent are stores
+ * (chase only loads), and the transposes as many as the transpose does. Everything is drawn from a generator seeded
+ * with -s, so the same options always give the same trace.
+ *
+ * Build with : gcc -g -Wall -Werror -std=c99 -m64 -O2 -o tracesynth -DTRANS_EVAL tracesynth.c transsim.c trans.c
+ *                  cachesim.c trace.c cachelab.c -lm */
+
+#include "trace.h"
+#include "trans.h"
+#include "transsim.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+#include <math.h>
+
+enum pattern { PATTERN_SEQ, PATTERN_STRIDE, PATTERN_RANDOM, PATTERN_ZIPF, PATTERN_CHASE, PATTERN_TRANS,
+               PATTERN_BLOCKING, PATTERN_SUBMIT };
+
+typedef struct {
+    trace_writer *out;
+    unsigned long long rng;
+    int write_percent;
+    int ok;
+} generator;
+
+/* Draws ranks from 1 to n with probabilities proportional to 1/rank^s by rejection-inversion (Hormann and Derflinger,
+ * 1996), in constant time and without a table */
+typedef struct {
+    long long n;
+    double s;
+    double h_integral_x1, h_integral_n, threshold;
+} zipf_sampler;
+
+int parse_pattern(const char *name);
+void zipf_init(zipf_sampler *z, long long n, double s);
+long long zipf_sample(zipf_sampler *z, generator *g);
+void emit(generator *g, char type, long long address, int size);
+char access_type(generator *g);
+unsigned long long next_random(generator *g);
+void transpose(generator *g, int pattern, int M, int N, int block_dim, long long base);
+void trans(int M, int N, int A[N][M], int B[M][N]);
+void transpose_blocking(int M, int N, int A[N][M], int B[M][N]);
+void transpose_submit(int M, int N, int A[N][M], int B[M][N]);
+
+/* The tiles of -B */
+static trans_tuning block_tuning;
+
+static void transpose_block(int M, int N, int A[N][M], int B[M][N]) {
+    transpose_tiled(M, N, A, B, &block_tuning);
+}
+void usage(char *argv[]);
+
+int main(int argc, char *argv[]) {
+    extern char* optarg;
+    int c, err_flag = 0, pattern = -1, text = 0, size = 8, M = 32, N = 32, block_dim = 0;
+    long long count = 1000000, base = 0x30b080, stride = 64, footprint = 1 << 20;
+    double exponent = 0.99;
+    char *out_file = NULL;
+    generator g;
+    memset(&g, 0, sizeof(g));
+    g.rng = 1;
+
+    while((c = getopt(argc, argv, "p:o:xn:a:k:f:e:w:l:M:N:B:s:h")) != -1) {
+        switch(c) {
+            case 'p':
+                pattern = parse_pattern(optarg);
+                break;
+            case 'o':
+                out_file = optarg;
+                break;
+            case 'x':
+                text = 1;
+                break;
+            case 'n':
+                count = atoll(optarg);
+                break;
+            case 'a':
+                base = strtoll(optarg, NULL, 16);
+                break;
+            case 'k':
+                stride = atoll(optarg);
+                break;
+            case 'f':
+                footprint = atoll(optarg);
+                break;
+            case 'e':
+                exponent = atof(optarg);
+                break;
+            case 'w':
+                g.write_percent = atoi(optarg);
+                break;
+            case 'l':
+                size = atoi(optarg);
+                break;
+            case 'M':
+                M = atoi(optarg);
+                break;
+            case 'N':
+                N = atoi(optarg);
+                break;
+            case 'B':
+                block_dim = atoi(optarg);
+                break;
+            case 's':
+                g.rng = strtoull(optarg, NULL, 10);
+                break;
+            case 'h':
+                usage(argv);
+                return 0;
+            default:
+                err_flag = 1;
+                break;
+        }
+    }
+    if ((pattern < 0) || (out_file == NULL) || err_flag) {
+        usage(argv);
+        return -1;
+    }
+    if ((count < 0) || (stride <= 0) || (footprint < stride) || (size <= 0) || (M <= 0) || (N <= 0) ||
+        (exponent <= 0) || (block_dim < 0) || (g.write_percent < 0) || (g.write_percent > 100)) {
+        fprintf(stderr, "the sizes and counts must be positive and the footprint hold at least one item\n");
+        return -2;
+    }
+
+    g.out = trace_create(out_file, text ? TRACE_TEXT : TRACE_BINARY);
+    if (g.out == NULL) {
+        fprintf(stderr, "could not create %s\n", out_file);
+        return -3;
+    }
+    g.ok = 1;
+
+    /* The items of random, zipf and chase, a power of two so that multiplying by an odd number permutes them */
+    long long items = 1;
+    while (items * stride < footprint) {
+        items *= 2;
+    }
+
+    switch (pattern) {
+        case PATTERN_SEQ:
+        case PATTERN_STRIDE: {
+            long long step = (pattern == PATTERN_SEQ) ? size : stride;
+            long long offset = 0;
+            for (long long i = 0; i < count; i++) {
+                emit(&g, access_type(&g), base + offset, size);
+                offset += step;
+                if (offset + size > footprint) {
+                    offset = 0;
+                }
+            }
+            break;
+        }
+        case PATTERN_RANDOM:
+            for (long long i = 0; i < count; i++) {
+                emit(&g, access_type(&g), base + (long long)(next_random(&g) & (items - 1)) * stride, size);
+            }
+            break;
+        case PATTERN_ZIPF: {
+            zipf_sampler z;
+            zipf_init(&z, items, exponent);
+            for (long long i = 0; i < count; i++) {
+                unsigned long long rank = (unsigned long long)zipf_sample(&z, &g) - 1;
+                long long item = (long long)((rank * 0x9E3779B97F4A7C15ULL) & (items - 1));
+                emit(&g, access_type(&g), base + item * stride, size);
+            }
+            break;
+        }
+        case PATTERN_CHASE: {
+            /* Sattolo's shuffle gives a permutation made of a single cycle, so the chase visits every item */
+            long long *next = (long long *)malloc(items * sizeof(long long));
+            for (long long i = 0; i < items; i++) {
+                next[i] = i;
+            }
+            for (long long i = items - 1; i > 0; i--) {
+                long long j = (long long)(next_random(&g) % (unsigned long long)i);
+                long long t = next[i];
+                next[i] = next[j];
+                next[j] = t;
+            }
+            long long item = 0;
+            for (long long i = 0; i < count; i++) {
+                emit(&g, 'L', base + item * stride, size);
+                item = next[item];
+            }
+            free(next);
+            break;
+        }
+        default:
+            transpose(&g, pattern, M, N, block_dim, base);
+            break;
+    }
+
+    long long records = g.out -> records;
+    if (!trace_finish(g.out) || !g.ok) {
+        fprintf(stderr, "could not write %s\n", out_file);
+        return -4;
+    }
+    fprintf(stderr, "records:%lld\n", records);
+    return 0;
+}
+
+void transpose(generator *g, int pattern, int M, int N, int block_dim, long long base) {
+/* transpose runs the transpose function of trans.c the pattern names, emitting the load from A and the store to B of
+ * every element */
+    trans_fn func = (pattern == PATTERN_TRANS) ? trans : (pattern == PATTERN_BLOCKING) ? transpose_blocking :
+                    transpose_submit;
+    if ((block_dim > 0) && (pattern != PATTERN_TRANS)) {
+        memset(&block_tuning, 0, sizeof(block_tuning));
+        block_tuning.M = M;
+        block_tuning.N = N;
+        block_tuning.tile_rows = block_dim;
+        block_tuning.tile_cols = block_dim;
+        block_tuning.defer_diagonal = (pattern == PATTERN_SUBMIT);
+        func = transpose_block;
+    }
+    trans_result res;
+    g -> ok = trans_sim_write(func, M, N, base, g -> out, &res) && res.correct && g -> ok;
+}
+
+void emit(generator *g, char type, long long address, int size) {
+    trace_record rec;
+    rec.address = address;
+    rec.stride = 0;
+    rec.count = 1;
+    rec.asid = -1;
+    rec.size = size;
+    rec.type = type;
+    g -> ok = trace_write(g -> out, &rec) && g -> ok;
+}
+
+/* log(1 + x) / x, by its series near 0 where the quotient tends to 0/0, for zipf_h_integral_inverse */
+static double log1p_over_x(double x) {
+    return (fabs(x) > 1e-8) ? log1p(x) / x : 1 - x * (0.5 - x * (1.0/3 - 0.25 * x));
+}
+
+/* (exp(x) - 1) / x, by its series near 0 where the quotient tends to 0/0, for zipf_h_integral */
+static double expm1_over_x(double x) {
+    return (fabs(x) > 1e-8) ? expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0/3) * (1 + 0.25 * x));
+}
+
+/* The integral of h(x) = 1/x^s and its inverse, written so that they also hold for s = 1 */
+static double zipf_h(const zipf_sampler *z, double x) {
+    return exp(-z -> s * log(x));
+}
+
+static double zipf_h_integral(const zipf_sampler *z, double x) {
+    double log_x = log(x);
+    return expm1_over_x((1 - z -> s) * log_x) * log_x;
+}
+
+static double zipf_h_integral_inverse(const zipf_sampler *z, double x) {
+    double t = x * (1 - z -> s);
+    if (t < -1) {
+        t = -1;
+    }
+    return exp(log1p_over_x(t) * x);
+}
+
+void zipf_init(zipf_sampler *z, long long n, double s) {
+    z -> n = n;
+    z -> s = s;
+    z -> h_integral_x1 = zipf_h_integral(z, 1.5) - 1;
+    z -> h_integral_n = zipf_h_integral(z, n + 0.5);
+    z -> threshold = 2 - zipf_h_integral_inverse(z, zipf_h_integral(z, 2.5) - zipf_h(z, 2));
+}
+
+long long zipf_sample(zipf_sampler *z, generator *g) {
+    for (;;) {
+        double u01 = (next_random(g) >> 11) * (1.0 / 9007199254740992.0);
+        double u = z -> h_integral_n + u01 * (z -> h_integral_x1 - z -> h_integral_n);
+        double x = zipf_h_integral_inverse(z, u);
+        long long k = (long long)(x + 0.5);
+        if (k < 1) {
+            k = 1;
+        } else if (k > z -> n) {
+            k = z -> n;
+        }
+        if ((k - x <= z -> threshold) || (u >= zipf_h_integral(z, k + 0.5) - zipf_h(z, (double)k))) {
+            return k;
+        }
+    }
+}
+
+char access_type(generator *g) {
+    if (g -> write_percent == 0) {
+        return 'L';
+    }
+    return ((int)(next_random(g) % 100) < g -> write_percent) ? 'S' : 'L';
+}
+
+unsigned long long next_random(generator *g) {
+/* next_random is splitmix64, fast and good enough to pick addresses */
+    unsigned long long z = (g -> rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+int parse_pattern(const char *name) {
+    static const char *names[] = { "seq", "stride", "random", "zipf", "chase", "trans", "blocking", "submit" };
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (strcmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void usage(char *argv[]) {
+    printf("%s -p <pattern> -o <file> [-x] [-n <num>] [-a <addr>] [-k <num>] [-f <num>] [-e <exp>] [-w <pct>] [-l <num>] [-M <num>] [-N <num>] [-B <num>] [-s <seed>]\n", argv[0]);
+    printf("\nOptions:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -p <pat>   Access pattern : seq, stride, random, zipf, chase, trans, blocking or submit.\n");
+    printf("  -o <file>  Trace to write, - for standard output.\n");
+    printf("  -x         Write a text trace instead of a binary one.\n");
+    printf("  -n <num>   Number of accesses, 1000000 by default. Ignored by the transposes.\n");
+    printf("  -a <addr>  First address in hex, 30b080 by default.\n");
+    printf("  -k <num>   Stride, and size of the items of random, zipf and chase, in bytes, 64 by default.\n");
+    printf("  -f <num>   Footprint in bytes, 1MB by default.\n");
+    printf("  -e <exp>   Exponent of the Zipf distribution, 0.99 by default.\n");
+    printf("  -w <pct>   Percentage of stores, 0 by default.\n");
+    printf("  -l <num>   Size of the accesses in bytes, 8 by default. The transposes access 4 byte ints.\n");
+    printf("  -M <num>   Number of columns of A for the transposes, 32 by default.\n");
+    printf("  -N <num>   Number of rows of A for the transposes, 32 by default.\n");
+    printf("  -B <num>   Side of square tiles replacing the blocks of the blocking and submit transposes.\n");
+    printf("  -s <seed>  Seed of the random patterns, 1 by default.\n");
+    printf("\nExample : %s -p zipf -n 10000000 -f 67108864 -o zipf.ctrace\n", argv[0]);
+}
@@ -0,0 +1,136 @@
+/* tracetrans.c - Traces the transpose functions registered by trans.c without valgrind, by compiling trans.c with
+ * clang's load and store instrumentation (see tracerec.h).
+ * Required inputs : the dimensions of the matrices (-M and -N)
+ *
+ * Every registered function transposes an N*M matrix A into B, and only the accesses to A and B are recorded. With -o
+ * the accesses of function i are written to the trace <prefix>.f<i>, in the binary format unless -x is given.
+ * Otherwise they are simulated while the function runs, on the cache described by the options of csim, the 1KB direct
+ * mapped cache with 32 byte blocks of the assignment by default, and the summary of every function is printed.
+ *
+ * Build with : clang -O0 -g -fsanitize-coverage=trace-loads,trace-stores -c trans.c
+ *              gcc -g -Wall -Werror -std=c99 -m64 -o tracetrans tracetrans.c tracerec.c cachesim.c trace.c cachelab.c
+ *                  trans.o -pthread */
+
+#include "cachelab.h"
+#include "cachesim.h"
+#include "tracerec.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+
+/* The largest matrices, the arrays are placed back to back as in the driver of the assignment */
+#define MAX_DIM 256
+
+extern trans_func_t func_list[MAX_TRANS_FUNCS];
+extern int func_counter;
+void registerFunctions(void);
+
+static int matrices[2][MAX_DIM * MAX_DIM] __attribute__((aligned(64)));
+
+void usage(char *argv[]);
+
+int main(int argc, char *argv[]) {
+    extern char* optarg;
+    int M = 0, N = 0, c, err_flag = 0, text = 0;
+    char *prefix = NULL;
+    sim_config cfg;
+    sim_config_init(&cfg);
+
+    while((c = getopt(argc, argv, SIM_OPTIONS "M:N:o:xh")) != -1) {
+        switch(c) {
+            case 'M':
+                M = atoi(optarg);
+                break;
+            case 'N':
+                N = atoi(optarg);
+                break;
+            case 'o':
+                prefix = optarg;
+                break;
+            case 'x':
+                text = 1;
+                break;
+            case 'h':
+                usage(argv);
+                return 0;
+            default:
+                if (sim_parse_option(&cfg, c, optarg) <= 0) {
+                    err_flag = 1;
+                }
+                break;
+        }
+    }
+    if ((M <= 0) || (N <= 0) || (M > MAX_DIM) || (N > MAX_DIM) || err_flag) {
+        usage(argv);
+        return -1;
+    }
+    if (!sim_config_complete(&cfg)) {
+        cfg.s = 5;
+        cfg.assoc = 1;
+        cfg.b = 5;
+    }
+
+    int (*A)[M] = (int (*)[M])matrices[0];
+    int (*B)[N] = (int (*)[N])matrices[1];
+    tracerec_range(A, A + N);
+    tracerec_range(B, B + M);
+    registerFunctions();
+
+    for (int f = 0; f < func_counter; f++) {
+        simulator sim;
+        if (prefix != NULL) {
+            char path[4096];
+            snprintf(path, sizeof(path), "%s.f%d", prefix, f);
+            if (!tracerec_open(path, text ? TRACE_TEXT : TRACE_BINARY)) {
+                fprintf(stderr, "could not create %s\n", path);
+                return -3;
+            }
+        } else {
+            if (!simulator_init(&sim, &cfg)) {
+                return -2;
+            }
+            tracerec_set_sink(simulate_batch, &sim);
+        }
+
+        initMatrix(M, N, A, B);
+        tracerec_start();
+        (*func_list[f].func_ptr)(M, N, A, B);
+        tracerec_stop();
+
+        int correct = 1;
+        for (int i = 0; i < N; i++) {
+            for (int j = 0; j < M; j++) {
+                correct = correct && (A[i][j] == B[j][i]);
+            }
+        }
+        printf("func %d (%s): correct:%d ", f, func_list[f].description, correct);
+        if (prefix != NULL) {
+            if (!tracerec_close()) {
+                fprintf(stderr, "could not write %s.f%d\n", prefix, f);
+                return -4;
+            }
+            printf("trace:%s.f%d\n", prefix, f);
+        } else {
+            coalesce_flush(&sim);
+            printSummary((int)sim.l1d.hits, (int)sim.l1d.misses, (int)sim.l1d.evictions);
+            print_statistics(&sim, stdout);
+            simulator_free(&sim);
+        }
+    }
+    return 0;
+}
+
+void usage(char *argv[]) {
+    printf("%s [-hx] -M <num> -N <num> [-o <prefix>] [csim options]\n", argv[0]);
+    printf("\nOptions:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -M <num>   Number of columns of A, at most %d.\n", MAX_DIM);
+    printf("  -N <num>   Number of rows of A, at most %d.\n", MAX_DIM);
+    printf("  -o <prefix> Write the accesses of function i to <prefix>.f<i> instead of simulating them.\n");
+    printf("  -x         Write text traces instead of binary ones.\n");
+    printf("\nSimulation options, the cache defaults to -s 5 -E 1 -b 5:\n");
+    sim_print_options();
+    printf("\nExample : %s -M 32 -N 32\n", argv[0]);
+}
@@ -0,0 +1,184 @@
+/* tracezip.c - Compresses a trace into the strided runs and groups of interleaved runs of the binary trace format (see
+ * trace.h), which csim simulates without decoding every access.
+ * Required inputs : the trace to compress (-i) and the output file (-o)
+ *
+ * The trace is read through a window of records. At every position, each group size p from 1 to the maximum (-p) is
+ * tried: the p records starting there and the p records following them fix the stride of every member, and the group
+ * is extended for as long as all the members keep their type, size, ASID and stride. The group covering the most
+ * records is written out, or the record on its own when no group repeats at least twice. Runs and groups already
+ * present in the input are expanded first, so compressing a compressed trace again gives the same result.
+ *
+ * Build with : gcc -g -Wall -Werror -std=c99 -m64 -o tracezip tracezip.c trace.c */
+
+#include "trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+
+/* Number of records searched for groups at a time, groups never extend past the window */
+#define WINDOW (1 << 16)
+
+int is_plain(const trace_record *rec);
+int same_stream(const trace_record *a, const trace_record *b);
+void usage(char *argv[]);
+
+int main(int argc, char *argv[]) {
+    extern char* optarg;
+    char *in_file = NULL, *out_file = NULL;
+    int c, max_p = TRACE_MAX_GROUP, err_flag = 0, format = TRACE_TEXT;
+
+    while((c = getopt(argc, argv, "i:o:p:f:h")) != -1) {
+        switch(c) {
+            case 'i':
+                in_file = optarg;
+                break;
+            case 'o':
+                out_file = optarg;
+                break;
+            case 'p':
+                max_p = atoi(optarg);
+                if ((max_p < 1) || (max_p > TRACE_MAX_GROUP)) {
+                    err_flag = 1;
+                }
+                break;
+            case 'f':
+                format = trace_parse_format(optarg);
+                if (format < 0) {
+                    err_flag = 1;
+                }
+                break;
+            case 'h':
+                usage(argv);
+                return 0;
+            default:
+                err_flag = 1;
+                break;
+        }
+    }
+    if ((in_file == NULL) || (out_file == NULL) || err_flag) {
+        usage(argv);
+        return -1;
+    }
+
+    trace_accesses src;
+    trace_accesses_init(&src, trace_open_as(in_file, format));
+    if (src.reader == NULL) {
+        fprintf(stderr, "could not open trace file %s\n", in_file);
+        return -3;
+    }
+    trace_record *window = (trace_record *)malloc(WINDOW * sizeof(trace_record));
+    if (window == NULL) {
+        fprintf(stderr, "could not allocate the window of %d records\n", WINDOW);
+        return -3;
+    }
+    trace_writer *out = trace_create(out_file, TRACE_BINARY);
+    if (out == NULL) {
+        fprintf(stderr, "could not create %s\n", out_file);
+        return -3;
+    }
+
+    long long records_in = 0, runs = 0, groups = 0;
+    int n = 0, pos = 0, eof = 0, ok = 1;
+
+    while (ok) {
+        /* Keep the window at least half full so that groups are not cut short needlessly */
+        if (!eof && (n - pos < WINDOW / 2)) {
+            memmove(window, window + pos, (n - pos) * sizeof(trace_record));
+            n -= pos;
+            pos = 0;
+            while ((n < WINDOW) && trace_next_access(&src, &window[n])) {
+                n++;
+                records_in++;
+            }
+            eof = (n < WINDOW);
+        }
+        if (pos == n) {
+            break;
+        }
+
+        int best_p = 1;
+        long long best_count = 1;
+        for (int p = 1; (p <= max_p) && (pos + 2*p <= n); p++) {
+            trace_record *first = &window[pos], *second = &window[pos + p];
+            int matches = 1;
+            for (int i = 0; i < p; i++) {
+                matches = matches && is_plain(&first[i]) && same_stream(&first[i], &second[i]);
+            }
+            if (!matches) {
+                continue;
+            }
+
+            long long count = 2;
+            while ((pos + (count + 1) * p <= n) && (count < TRACE_MAX_COUNT)) {
+                trace_record *next = &window[pos + count * p];
+                for (int i = 0; matches && (i < p); i++) {
+                    matches = same_stream(&first[i], &next[i]) &&
+                              (next[i].address == first[i].address + count * (second[i].address - first[i].address));
+                }
+                if (!matches) {
+                    break;
+                }
+                count++;
+            }
+            if (count * p > best_count * best_p) {
+                best_p = p;
+                best_count = count;
+            }
+        }
+
+        if (best_count == 1) {
+            ok = trace_write(out, &window[pos]);
+        } else {
+            trace_record members[TRACE_MAX_GROUP];
+            for (int i = 0; i < best_p; i++) {
+                members[i] = window[pos + i];
+                members[i].stride = window[pos + best_p + i].address - window[pos + i].address;
+            }
+            if (best_p == 1) {
+                runs++;
+                members[0].count = best_count;
+                ok = trace_write(out, &members[0]);
+            } else {
+                groups++;
+                ok = trace_write_group(out, members, best_p, best_count);
+            }
+        }
+        pos += best_count * best_p;
+    }
+
+    int malformed = src.reader -> malformed;
+    trace_close(src.reader);
+    long long records_out = out -> records;
+    if (!trace_finish(out) || !ok) {
+        fprintf(stderr, "could not write %s\n", out_file);
+        return -4;
+    }
+    if (malformed) {
+        fprintf(stderr, "malformed record or group in trace file %s, %s holds the accesses before it\n", in_file,
+                out_file);
+        return -3;
+    }
+    free(window);
+    printf("records_in:%lld records_out:%lld runs:%lld groups:%lld\n", records_in, records_out, runs, groups);
+    return 0;
+}
+
+int is_plain(const trace_record *rec) {
+/* Context switches and TLB shootdowns only apply once and are never part of a group */
+    return (rec -> type != 'X') && (rec -> type != 'K');
+}
+
+int same_stream(const trace_record *a, const trace_record *b) {
+    return (a -> type == b -> type) && (a -> size == b -> size) && (a -> asid == b -> asid);
+}
+
+void usage(char *argv[]) {
+    printf("%s -i <file> -o <file> [-p <num>] [-f <fmt>]\n", argv[0]);
+    printf("\nOptions:\n");
+    printf("  -i <file>  Trace to compress, text or binary, - for standard input.\n");
+    printf("  -o <file>  Binary trace to write.\n");
+    printf("  -p <num>   Largest number of interleaved runs in a group, 1 to %d (default).\n", TRACE_MAX_GROUP);
+    printf("  -f <fmt>   Format of the input : text or binary (detected, default), din, champsim or raw.\n");
+    printf("\nExample : %s -i traces/trans.trace -o trans.ctrace\n", argv[0]);
+}
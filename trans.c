@@ -8,7 +8,20 @@
  * on a 1KB direct mapped cache with a block size of 32 bytes.
  */ 
 #include <stdio.h>
+#include <stdlib.h>
 #include "cachelab.h"
+#include "trans.h"
+
+/* The transposes access the matrices through LOAD and STORE only. Compiled with -DTRANS_EVAL, every access is also
+ * simulated on the spot by transsim.c, otherwise they are plain array accesses */
+#ifdef TRANS_EVAL
+#include "transsim.h"
+#define LOAD(A, i, j) (trans_sim_load(&(A)[i][j]), (A)[i][j])
+#define STORE(B, i, j, v) ((B)[i][j] = trans_sim_store(&(B)[i][j], (v)))
+#else
+#define LOAD(A, i, j) ((A)[i][j])
+#define STORE(B, i, j, v) ((B)[i][j] = (v))
+#endif
 
 void print_2Darray(int m, int (*mat)[m]) {
     for (int i=0; i<m; i++) {
@@ -35,6 +48,17 @@ int min(int a, int b) {
 
 char transpose_submit_desc[] = "Transpose submission";
 void transpose_submit(int M, int N, int A[N][M], int B[M][N])
+{
+    /* The matrices tuned for (see transtune.c) take the tiles found best by simulation, the others transpose_untuned */
+    const trans_tuning *t = trans_tuning_lookup(M, N, TRANS_CACHE_S, TRANS_CACHE_E, TRANS_CACHE_B);
+    if (t != NULL) {
+        transpose_tiled(M, N, A, B, t);
+    } else {
+        transpose_untuned(M, N, A, B);
+    }
+}
+
+void transpose_untuned(int M, int N, int A[N][M], int B[M][N])
 {
     /* Finding the transpose of a matrix with as few cache misses as possible. The algorithm below uses the technique of
      * blocking to improve the spatial locality of the accesses. The idea is to minimize conflict misses by ensuring that 
@@ -50,42 +74,222 @@ void transpose_submit(int M, int N, int A[N][M], int B[M][N])
      * block which is still needed resulting in conflict miss when the evicted block is needed again. The same holds for the 64*64 
      * matrix except that in this case, 4 rows is the threshold rather than 8 */
 
-    /* The above argument only holds for matrices where number of columns is a multiple of 8 (32*32 and 64*64) since
-     * blocks of 8 ints will not neatly conform to the rows of the matrix. The best block size is found to be 18 by trial 
-     * and error for the 61*67 matrix */
+    /* The argument is carried out for any matrix and cache by trans_block_dim, which counts the rows whose lines are
+     * cached without conflicts rather than dividing the number of sets by M/8: that only holds for the matrices where
+     * the number of columns is a multiple of 8, and divides by zero below 8 columns. For the 32*32 and 64*64 matrices
+     * it finds 8 and 4 */
+
+    /* Conflict misses along the diagonal are particularly tricky since the the element in A being "load"ed and the
+     * index in B where it is being "store"d map to the same set and one operation evicts the other data which will be
+     * accessed in the near future. So, such elements are dealt with separately at the end of the row of their block,
+     * after all the other accesses are processed and the the blocks are no longer needed: the diagonal, and for the
+     * 64*64 matrix the elements 4 away from it */
+    const trans_geometry assignment = TRANS_GEOMETRY_ASSIGNMENT;
+    transpose_geometry(M, N, A, B, &assignment);
+}
+
+#include "transtable.h"
+
+const trans_tuning *trans_tuning_lookup(int M, int N, int s, int E, int b)
+{
+    /* The table ends with an entry whose M is 0 */
+    for (const trans_tuning *t = trans_table; t -> M != 0; t++) {
+        if ((t -> M == M) && (t -> N == N) && (t -> s == s) && (t -> E == E) && (t -> b == b)) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * transpose_tile - Transposes the elements of rows [i, i_end) and columns [j, j_end) of A
+ */
+static void transpose_tile(int M, int N, int A[N][M], int B[M][N], int i, int i_end, int j, int j_end,
+                           int inner_columns, int defer_diagonal)
+{
+    if (!inner_columns) {
+        for (int ib = i; ib < i_end; ib++) {
+            int deferred = 0;
+            for (int jb = j; jb < j_end; jb++) {
+                if (defer_diagonal && (ib == jb)) {
+                    deferred = 1;
+                } else {
+                    STORE(B, jb, ib, LOAD(A, ib, jb));
+                }
+            }
+            if (deferred) {
+                STORE(B, ib, ib, LOAD(A, ib, ib));
+            }
+        }
+    } else {
+        for (int jb = j; jb < j_end; jb++) {
+            int deferred = 0;
+            for (int ib = i; ib < i_end; ib++) {
+                if (defer_diagonal && (ib == jb)) {
+                    deferred = 1;
+                } else {
+                    STORE(B, jb, ib, LOAD(A, ib, jb));
+                }
+            }
+            if (deferred) {
+                STORE(B, jb, jb, LOAD(A, jb, jb));
+            }
+        }
+    }
+}
+
+/*
+ * transpose_tiled - Transposes A tile by tile, as described by a tuning of trans.h
+ */
+void transpose_tiled(int M, int N, int A[N][M], int B[M][N], const trans_tuning *t)
+{
+    /* The tuning is read once: it lives in the static table, whose lines would otherwise compete with those of the
+     * matrices on every tile */
+    int tile_rows = t -> tile_rows, tile_cols = t -> tile_cols;
+    int order = t -> order, defer_diagonal = t -> defer_diagonal;
+    int rows_of_tiles = (N + tile_rows - 1) / tile_rows, cols_of_tiles = (M + tile_cols - 1) / tile_cols;
+    for (int k = 0; k < rows_of_tiles * cols_of_tiles; k++) {
+        int i = ((order & TILE_COLUMNS_FIRST) ? k % rows_of_tiles : k / cols_of_tiles) * tile_rows;
+        int j = ((order & TILE_COLUMNS_FIRST) ? k / rows_of_tiles : k % cols_of_tiles) * tile_cols;
+        transpose_tile(M, N, A, B, i, min(i + tile_rows, N), j, min(j + tile_cols, M),
+                       (order & TILE_INNER_COLUMNS) != 0, defer_diagonal);
+    }
+}
+
+/*
+ * set_of - The set of the cache g holding the byte at offset bytes from the start of A, which starts a line
+ */
+static long long set_of(long long offset, const trans_geometry *g)
+{
+    long long line = (offset >= 0) ? offset / g -> line_bytes : -((-offset + g -> line_bytes - 1) / g -> line_bytes);
+    return ((line % g -> sets) + g -> sets) % g -> sets;
+}
+
+/*
+ * conflict_free_rows - Counts the rows of a matrix width elements wide, from the first and at most max_rows, whose
+ *     first elements are cached together without a set holding more lines than it has ways
+ */
+static int conflict_free_rows(int width, int max_rows, const trans_geometry *g)
+{
+    /* The handout forbids arrays in the transposes, so rather than counting the lines of each set, the earlier lines
+     * of the set of each new line are checked for a row starting in them. Narrow rows share lines, a line is only
+     * counted once */
+    long long row_bytes = (long long)width * g -> element_bytes, line, other;
+    int rows, earlier;
+    for (rows = 1; rows < max_rows; rows++) {
+        line = rows * row_bytes / g -> line_bytes;
+        if (line == (rows - 1) * row_bytes / g -> line_bytes) {
+            continue;
+        }
+        earlier = 0;
+        for (other = line - g -> sets; (other >= 0) && (earlier < g -> assoc); other -= g -> sets) {
+            /* The first row starting at or after the line other starts in it */
+            earlier += ((other * g -> line_bytes + row_bytes - 1) / row_bytes * row_bytes <
+                        (other + 1) * g -> line_bytes);
+        }
+        if (earlier == g -> assoc) {
+            break;
+        }
+    }
+    return rows;
+}
+
+/*
+ * misaligned_blocks - Counts the blocks, among per_line consecutive blocks of block_dim columns, whose first block_dim
+ *     rows in a matrix width elements wide are not cached together: the lines of a block narrower than a line depend
+ *     on where in its line it starts
+ */
+static int misaligned_blocks(int width, int block_dim, int per_line, const trans_geometry *g)
+{
+    /* As in conflict_free_rows, the earlier lines of the set of each line of a row are checked for a row of the block
+     * in them, the last row starting before the end of the line being the only one which may reach it */
+    long long row_bytes = (long long)width * g -> element_bytes, bytes = (long long)block_dim * g -> element_bytes;
+    long long start, line, other;
+    int k, r, earlier = 0, misaligned = 0;
+    for (k = 0; k < per_line; k++) {
+        start = k * bytes;
+        for (r = 1; (r < block_dim) && (earlier < g -> assoc); r++) {
+            for (line = (r * row_bytes + start + bytes - 1) / g -> line_bytes;
+                 (line >= (r * row_bytes + start) / g -> line_bytes) && (earlier < g -> assoc) &&
+                 (line > ((r - 1) * row_bytes + start + bytes - 1) / g -> line_bytes); line--) {
+                earlier = 0;
+                for (other = line - g -> sets; (other >= start / g -> line_bytes) && (earlier < g -> assoc);
+                     other -= g -> sets) {
+                    earlier += (((other + 1) * g -> line_bytes - 1 - start) / row_bytes * row_bytes + start + bytes >
+                                other * g -> line_bytes);
+                }
+            }
+        }
+        misaligned += (earlier == g -> assoc);
+        earlier = 0;
+    }
+    return misaligned;
+}
+
+/*
+ * block_lines - The lines a block of block_dim rows and columns takes in a matrix width elements wide: those of each
+ *     row, or of the rows it spans when they are narrow enough to share lines
+ */
+static long long block_lines(int width, int block_dim, int per_line, const trans_geometry *g)
+{
+    long long spanned = ((long long)block_dim * width * g -> element_bytes + g -> line_bytes - 1) / g -> line_bytes + 1;
+    long long per_row = (long long)block_dim * ((block_dim + per_line - 1) / per_line);
+    return (spanned < per_row) ? spanned : per_row;
+}
 
-    int num_sets = 32;
-    int sets_per_row = M/8;
-    int block_dim = (M == N) ? num_sets/sets_per_row : 18;
-    int idx1, idx2, diag_flag = 0;
+int trans_block_dim(int M, int N, const trans_geometry *g)
+{
+    /* The rows of A and of B a block touches are used over and over while it is transposed and must stay cached: the
+     * block is no taller than the rows of A, and no wider than the rows of B, which are cached without conflicts, and
+     * the lines of both fit in the cache. It is then cut down to whole lines when it spans more than one */
+    if ((g -> sets <= 0) || (g -> assoc <= 0) || (g -> line_bytes <= 0) || (g -> element_bytes <= 0)) {
+        return 1;
+    }
+    int per_line = (g -> line_bytes > g -> element_bytes) ? g -> line_bytes / g -> element_bytes : 1;
+    int block_dim = min(conflict_free_rows(M, N, g), conflict_free_rows(N, M, g));
+    while ((block_dim > 1) && (block_lines(M, block_dim, per_line, g) + block_lines(N, block_dim, per_line, g) >
+                               (long long)g -> sets * g -> assoc)) {
+        block_dim--;
+    }
+    /* A block covering the whole matrix is left whole */
+    if ((block_dim > per_line) && ((block_dim < M) || (block_dim < N))) {
+        block_dim -= block_dim % per_line;
+    }
+    /* The rows whose first elements are cached together may still collide past them. Blocks of two rows which collide
+     * in both matrices at most of the places they can start in a line miss more often than the row by row scan, which
+     * the assignment's constants gave these matrices */
+    if ((block_dim == 2) && (block_dim < per_line) &&
+        (2 * misaligned_blocks(M, block_dim, per_line, g) > per_line) &&
+        (2 * misaligned_blocks(N, block_dim, per_line, g) > per_line)) {
+        block_dim = 1;
+    }
+    return block_dim;
+}
+
+void transpose_geometry(int M, int N, int A[N][M], int B[M][N], const trans_geometry *g)
+{
+    /* The sets of the lines are those of the offsets from A, which holds as long as A starts a line. An element whose
+     * line in A shares a set with its line in B would evict one with the other: each row of a block is copied in two
+     * passes, the second copying these elements once the rest of the row is. With two ways or more, both lines are
+     * cached and there is no second pass */
+    int block_dim = trans_block_dim(M, N, g);
     for (int i = 0; i < N; i += block_dim) {
         for (int j = 0; j < M; j += block_dim) {
-            
-            /* Transposing the smaller block matrices */
             for (int ib = i; ib < min(i+block_dim, N); ib++) {
-                for (int jb = j; jb < min(j+block_dim, M); jb++) {
-                    /* Conflict misses along the diagonal are particularly tricky since the the element in A being
-                     * "load"ed and the index in B where it is being "store"d map to the same set and one operation evicts the
-                     * other data which will be accessed in the near future. So, the diagonal elements are dealt with separately 
-                     * at the end after all the other accesses are processed and the the blocks are no longer needed */
-                    if ((ib != jb) && ((M != 64) || ((ib != jb-4) && (ib != jb+4)))) {
-                        B[jb][ib] = A[ib][jb];
-                    } else {
-                        diag_flag = 1;
-                        idx1 = ib;
-                        idx2 = jb;
+                for (int pass = 0; pass <= (g -> assoc == 1); pass++) {
+                    for (int jb = j; jb < min(j+block_dim, M); jb++) {
+                        if ((g -> assoc == 1) && ((set_of((char *)&A[ib][jb] - (char *)A, g) ==
+                                                   set_of((char *)&B[jb][ib] - (char *)A, g)) != pass)) {
+                            continue;
+                        }
+                        STORE(B, jb, ib, LOAD(A, ib, jb));
                     }
                 }
-                if (diag_flag) {
-                    B[idx2][idx1] = A[idx1][idx2];
-                    diag_flag = 0;
-                }
             }
         }
     }
 }
 
-  
 /* 
  * You can define additional transpose functions below. We've defined
  * a simple one below to help you get started. 
@@ -99,7 +303,7 @@ void trans(int M, int N, int A[N][M], int B[M][N])
     int i, j;
     for (i = 0; i < N; i++) {
         for (j = 0; j < M; j++) {
-            B[j][i] = A[i][j];
+            STORE(B, j, i, LOAD(A, i, j));
         }
     }    
 
@@ -108,15 +312,14 @@ void trans(int M, int N, int A[N][M], int B[M][N])
 char transpose_blocking_desc[] = "Simple blocking";
 void transpose_blocking(int M, int N, int A[N][M], int B[M][N])
 {
-    int num_sets = 32;
-    int sets_per_row = M/8;
-    int block_dim = num_sets/sets_per_row;
+    const trans_geometry assignment = TRANS_GEOMETRY_ASSIGNMENT;
+    int block_dim = trans_block_dim(M, N, &assignment);
     for (int i = 0; i < N; i += block_dim) {
         for (int j = 0; j < M; j += block_dim) {
 
             for (int ib = i; ib < min(i+block_dim, N); ib++) {
                 for (int jb = j; jb < min(j+block_dim, M); jb++) {
-                    B[jb][ib] = A[ib][jb];
+                    STORE(B, jb, ib, LOAD(A, ib, jb));
                 }
             }
         }
@@ -126,30 +329,10 @@ void transpose_blocking(int M, int N, int A[N][M], int B[M][N])
 char transpose_square_matrix_desc[] = "Transpose blocking with block size 8 for 32*32 and 4 for 64*64";
 void transpose_square_matrix(int M, int N, int A[N][M], int B[M][N])
 {
-    int num_sets = 32;
-    int sets_per_row = M/8;
-    int block_dim = num_sets/sets_per_row;
-    int idx1, idx2, diag_flag = 0;
-    for (int i = 0; i < N; i += block_dim) {
-        for (int j = 0; j < M; j += block_dim) {
-
-            for (int ib = i; ib < min(i+block_dim, N); ib++) {
-                for (int jb = j; jb < min(j+block_dim, M); jb++) {
-                    if ((ib != jb) && ((M == 32) || ((ib != jb-4) && (ib != jb+4)))) {
-                        B[jb][ib] = A[ib][jb];
-                    } else {
-                        diag_flag = 1;
-                        idx1 = ib;
-                        idx2 = jb;
-                    }
-                }
-                if (diag_flag) {
-                    B[idx2][idx1] = A[idx1][idx2];
-                    diag_flag = 0;
-                }
-            }
-        }
-    }
+    /* The block sizes and the elements left to the end of the rows are those trans_block_dim and transpose_geometry
+     * derive from the cache of the assignment */
+    const trans_geometry assignment = TRANS_GEOMETRY_ASSIGNMENT;
+    transpose_geometry(M, N, A, B, &assignment);
 }
 
 /*
@@ -0,0 +1,49 @@
+/* trans.h - The tunable transpose of trans.c and the tunings transpose_submit consults
+ *
+ * A tuning describes a tiled transpose for matrices of one size on one cache: the shape of the tiles, the order in
+ * which the tiles and the elements within them are visited, and whether the element on the diagonal of A is copied
+ * last, once the rest of its row has been, as it shares a set with the element of B it is copied to. The tunings are
+ * found by transtune, which simulates every candidate, and written to transtable.h. */
+
+#ifndef TRANS_H
+#define TRANS_H
+
+/* The cache of the assignment, the one transpose_submit is graded on */
+#define TRANS_CACHE_S 5
+#define TRANS_CACHE_E 1
+#define TRANS_CACHE_B 5
+
+/* The bits of trans_tuning.order. The tiles are visited along the rows of A unless TILE_COLUMNS_FIRST is set, and the
+ * elements of a tile row after row of A unless TILE_INNER_COLUMNS is set */
+#define TILE_COLUMNS_FIRST 1
+#define TILE_INNER_COLUMNS 2
+#define TILE_ORDERS 4
+
+/* A cache of sets sets of assoc lines of line_bytes bytes, and the size of the elements transposed, sizeof(int) for the
+ * transposes of trans.c */
+typedef struct {
+    int sets, assoc, line_bytes, element_bytes;
+} trans_geometry;
+
+/* The geometry of the cache of the assignment */
+#define TRANS_GEOMETRY_ASSIGNMENT {1 << TRANS_CACHE_S, TRANS_CACHE_E, 1 << TRANS_CACHE_B, (int)sizeof(int)}
+
+typedef struct {
+    /* A is an N*M matrix, tuned for a cache of 2^s sets of E lines of 2^b bytes */
+    int M, N, s, E, b;
+    int tile_rows, tile_cols, order, defer_diagonal;
+} trans_tuning;
+
+/* trans_tuning_lookup returns the tuning of transtable.h for the matrix and the cache, or a nullptr if there is none */
+const trans_tuning *trans_tuning_lookup(int M, int N, int s, int E, int b);
+void transpose_tiled(int M, int N, int A[N][M], int B[M][N], const trans_tuning *t);
+/* trans_block_dim returns the side of the square blocks transpose_geometry uses for an N*M matrix on the cache g, at
+ * least 1 */
+int trans_block_dim(int M, int N, const trans_geometry *g);
+/* transpose_geometry transposes A in square blocks derived from g, copying last in each row of a block the elements
+ * whose lines in A and B share a set */
+void transpose_geometry(int M, int N, int A[N][M], int B[M][N], const trans_geometry *g);
+/* transpose_untuned is what transpose_submit does for the matrices and caches which have no tuning */
+void transpose_untuned(int M, int N, int A[N][M], int B[M][N]);
+
+#endif
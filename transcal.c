@@ -0,0 +1,253 @@
+/* transcal.c - Calibrates the simulator against the hardware on the transposes of trans.c. Every registered function
+ * is run natively under the performance counters of the processor (perf_event_open) and then traced and simulated
+ * in-process as tracetrans does, and the misses counted by both are reported side by side.
+ * Required inputs : none, the matrix sizes and the hierarchy have defaults
+ *
+ * The simulated hierarchy is given with the options of csim: the L1 data cache, the last level cache with -L and the
+ * data TLB with -T. What is not given is read from /sys/devices/system/cpu/cpu0/cache, so that by default the L1 data
+ * cache and the last level cache of the host are simulated with a 64 entry TLB. A last level cache whose number of
+ * sets is not a power of two is simulated with the largest power of two below it.
+ *
+ * Each native run starts from caches and TLB emptied by streaming a buffer larger than the last level cache, as the
+ * simulation starts cold, and the smallest counts of -r runs are kept. One line is printed per function and size:
+ *   calibrate func:1 M:32 N:32 correct:1 ns:5120 l1d_sim:287 l1d_hw:301 l1d_error:+4.9%
+ *             llc_sim:256 llc_hw:262 llc_error:+2.3% dtlb_sim:4 dtlb_hw:6 dtlb_error:+50.0%
+ * all on one line, and a line with the mean absolute error of every function over the sizes. The error is relative to
+ * the simulated count. The counters only see what the simulator does not model as noise: the accesses of the stack
+ * and of the instrumentation callbacks, which run disabled during the native runs, prefetches and the physical
+ * indexing of the last level cache (see -P). A counter which cannot be opened, as in most virtual machines or with
+ * a restrictive perf_event_paranoid, is reported as n/a and the simulated counts are still printed.
+ *
+ * Build with : clang -O0 -g -fsanitize-coverage=trace-loads,trace-stores -c trans.c
+ *              gcc -g -Wall -Werror -std=c99 -m64 -o transcal transcal.c hostperf.c tracerec.c cachesim.c trace.c
+ *                  cachelab.c trans.o -pthread */
+
+#include "cachelab.h"
+#include "cachesim.h"
+#include "tracerec.h"
+#include "hostperf.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+
+/* The largest matrices, the arrays are placed back to back as in the driver of the assignment */
+#define MAX_DIM 1024
+#define MAX_SIZES 32
+#define DEFAULT_SIZES "32x32,64x64,61x67"
+#define DEFAULT_TLB_ENTRIES 64
+
+extern trans_func_t func_list[MAX_TRANS_FUNCS];
+extern int func_counter;
+void registerFunctions(void);
+
+static int matrices[2][MAX_DIM * MAX_DIM] __attribute__((aligned(64)));
+
+int log2_floor(long long n);
+void print_error(const char *name, long long sim, long long hw, int measured, double *sum);
+void usage(char *argv[]);
+
+int main(int argc, char *argv[]) {
+    extern char* optarg;
+    int c, err_flag = 0, runs = 5;
+    char default_sizes[] = DEFAULT_SIZES;
+    char *sizes_spec = default_sizes;
+    int num_sizes = 0, rows[MAX_SIZES], cols[MAX_SIZES];
+    sim_config cfg;
+    sim_config_init(&cfg);
+
+    while((c = getopt(argc, argv, SIM_OPTIONS "m:r:h")) != -1) {
+        switch(c) {
+            case 'm':
+                sizes_spec = optarg;
+                break;
+            case 'r':
+                runs = atoi(optarg);
+                break;
+            case 'h':
+                usage(argv);
+                return 0;
+            default:
+                if (sim_parse_option(&cfg, c, optarg) <= 0) {
+                    err_flag = 1;
+                }
+                break;
+        }
+    }
+    for (char *item = strtok(sizes_spec, ","); item != NULL; item = strtok(NULL, ",")) {
+        int m, n;
+        char rest;
+        if ((num_sizes == MAX_SIZES) || (sscanf(item, "%dx%d%c", &m, &n, &rest) != 2) || (m <= 0) || (n <= 0) ||
+            (m > MAX_DIM) || (n > MAX_DIM)) {
+            err_flag = 1;
+            break;
+        }
+        cols[num_sizes] = m;
+        rows[num_sizes] = n;
+        num_sizes++;
+    }
+    if ((num_sizes == 0) || (runs <= 0) || err_flag) {
+        usage(argv);
+        return -1;
+    }
+
+    /* The parts of the hierarchy which were not given are those of the host */
+    host_cache l1d, llc;
+    host_cache_read(1, &l1d);
+    host_cache_read(0, &llc);
+    if (!sim_config_complete(&cfg)) {
+        if (!l1d.found) {
+            fprintf(stderr, "the L1 data cache of the host is unknown, give its geometry with -s, -E and -b\n");
+            return -1;
+        }
+        cfg.s = log2_floor(l1d.sets);
+        cfg.assoc = l1d.assoc;
+        cfg.b = log2_floor(l1d.line);
+    }
+    if (!cfg.l2cache && llc.found && (llc.level > 1)) {
+        cfg.l2cache = 1;
+        cfg.l2_s = log2_floor(llc.sets);
+        cfg.l2_E = llc.assoc;
+        cfg.l2_b = log2_floor(llc.line);
+        if ((1 << cfg.l2_s) != llc.sets) {
+            fprintf(stderr, "the last level cache has %d sets, %d are simulated\n", llc.sets, 1 << cfg.l2_s);
+        }
+    }
+    if (cfg.tlb_entries == 0) {
+        cfg.tlb_entries = DEFAULT_TLB_ENTRIES;
+    }
+    printf("calibrate l1d:%d:%d:%d llc:", cfg.s, cfg.assoc, cfg.b);
+    if (cfg.l2cache) {
+        printf("%d:%d:%d", cfg.l2_s, cfg.l2_E, cfg.l2_b);
+    } else {
+        printf("none");
+    }
+    printf(" tlb_entries:%d\n", cfg.tlb_entries);
+
+    size_t flush_bytes = hostperf_flush_bytes();
+    char *flush_buffer = (char *)malloc(flush_bytes);
+    if (flush_buffer == NULL) {
+        fprintf(stderr, "could not allocate %zu bytes\n", flush_bytes);
+        return -2;
+    }
+    memset(flush_buffer, 0, flush_bytes);
+
+    hostperf hp;
+    int measured = hostperf_open(&hp);
+    if (measured == 0) {
+        printf("calibrate counters:unavailable\n");
+    }
+
+    registerFunctions();
+    double error_sum[MAX_TRANS_FUNCS][HOSTPERF_METRICS];
+    memset(error_sum, 0, sizeof(error_sum));
+
+    for (int z = 0; z < num_sizes; z++) {
+        int M = cols[z], N = rows[z];
+        int (*A)[M] = (int (*)[M])matrices[0];
+        int (*B)[N] = (int (*)[N])matrices[1];
+        tracerec_clear_ranges();
+        tracerec_range(A, A + N);
+        tracerec_range(B, B + M);
+
+        for (int f = 0; f < func_counter; f++) {
+            /* The native runs, with the instrumentation disabled */
+            long long best[HOSTPERF_METRICS];
+            double best_seconds = 0;
+            for (int r = 0; r < runs; r++) {
+                long long values[HOSTPERF_METRICS];
+                initMatrix(M, N, A, B);
+                hostperf_flush(flush_buffer, flush_bytes);
+                double start = hostperf_seconds();
+                hostperf_enable(&hp, 1);
+                (*func_list[f].func_ptr)(M, N, A, B);
+                hostperf_enable(&hp, 0);
+                double seconds = hostperf_seconds() - start;
+                hostperf_read(&hp, values);
+                for (int k = 0; k < HOSTPERF_METRICS; k++) {
+                    best[k] = ((r == 0) || (values[k] < best[k])) ? values[k] : best[k];
+                }
+                best_seconds = ((r == 0) || (seconds < best_seconds)) ? seconds : best_seconds;
+            }
+
+            /* The traced run */
+            simulator sim;
+            if (!simulator_init(&sim, &cfg)) {
+                return -3;
+            }
+            tracerec_set_sink(simulate_batch, &sim);
+            initMatrix(M, N, A, B);
+            tracerec_start();
+            (*func_list[f].func_ptr)(M, N, A, B);
+            tracerec_stop();
+            coalesce_flush(&sim);
+
+            int correct = 1;
+            for (int i = 0; i < N; i++) {
+                for (int j = 0; j < M; j++) {
+                    correct = correct && (A[i][j] == B[j][i]);
+                }
+            }
+            long long simulated[HOSTPERF_METRICS] = {sim.l1d.misses, sim.l2cache ? sim.l2.misses : 0, sim.tlb_misses};
+            printf("calibrate func:%d M:%d N:%d correct:%d ns:%.0f", f, M, N, correct, best_seconds * 1e9);
+            for (int k = 0; k < HOSTPERF_METRICS; k++) {
+                if ((k != HOSTPERF_LLC) || sim.l2cache) {
+                    print_error(hostperf_names[k], simulated[k], best[k], measured & (1 << k), &error_sum[f][k]);
+                }
+            }
+            printf("\n");
+            simulator_free(&sim);
+        }
+    }
+
+    for (int f = 0; f < func_counter; f++) {
+        printf("calibrate func:%d (%s) sizes:%d", f, func_list[f].description, num_sizes);
+        for (int k = 0; k < HOSTPERF_METRICS; k++) {
+            if ((k == HOSTPERF_LLC) && !cfg.l2cache) {
+                continue;
+            }
+            if (measured & (1 << k)) {
+                printf(" %s_mean_error:%.1f%%", hostperf_names[k], error_sum[f][k] / num_sizes);
+            } else {
+                printf(" %s_mean_error:n/a", hostperf_names[k]);
+            }
+        }
+        printf("\n");
+    }
+    hostperf_close(&hp);
+    free(flush_buffer);
+    return 0;
+}
+
+int log2_floor(long long n) {
+    int bits = 0;
+    while ((2LL << bits) <= n) {
+        bits++;
+    }
+    return bits;
+}
+
+void print_error(const char *name, long long sim, long long hw, int measured, double *sum) {
+/* print_error prints the simulated and measured counts of a metric and adds the absolute relative error to sum */
+    printf(" %s_sim:%lld", name, sim);
+    if (!measured) {
+        printf(" %s_hw:n/a %s_error:n/a", name, name);
+        return;
+    }
+    double error = 100.0 * (hw - sim) / (sim > 0 ? sim : 1);
+    printf(" %s_hw:%lld %s_error:%+.1f%%", name, hw, name, error);
+    *sum += (error < 0) ? -error : error;
+}
+
+void usage(char *argv[]) {
+    printf("%s [-h] [-m <MxN,...>] [-r <num>] [csim options]\n", argv[0]);
+    printf("\nOptions:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -m <list>  Comma-separated matrix sizes, M columns by N rows, at most %d (default %s).\n", MAX_DIM,
+           DEFAULT_SIZES);
+    printf("  -r <num>   Native runs per function and size, the smallest counts are kept (default 5).\n");
+    printf("\nSimulation options, the L1 data cache and the last level cache (-L) default to those of the host and\n");
+    printf("the TLB (-T) to %d entries:\n", DEFAULT_TLB_ENTRIES);
+    sim_print_options();
+    printf("\nExample : %s -m 32x32,64x64 -r 10\n", argv[0]);
+}
@@ -0,0 +1,168 @@
+/* transeval.c - Evaluates the transpose functions registered by trans.c without valgrind or a trace: trans.c is
+ * compiled with -DTRANS_EVAL and every access to the matrices is simulated while the function runs (see transsim.h).
+ * Required inputs : none, the matrix sizes and the cache have defaults
+ *
+ * Every registered function is run on each of the -m sizes, by default the 32x32, 64x64 and 61x67 of the assignment
+ * and the 255x255, 257x257, 512x512 and 1024x1024 whose rows collide in its cache, where blocks of a few rows miss
+ * more than the row by row scan. The cache is described by the options of csim, the 1KB direct mapped cache with 32
+ * byte blocks of the assignment by default. One line is printed per function and size:
+ *   eval func:0 M:32 N:32 correct:1 accesses:2048 hits:1764 misses:284 evictions:252 seconds:0.00004
+ *        desc:Transpose submission
+ * all on one line.
+ *
+ * With -c, the accesses of each transpose are also written to a trace as tracesynth writes them, and the trace is read
+ * back and simulated as csim does. Its misses are added to the line as trace_misses, and transeval fails if they differ
+ * from those of the simulation in-process: transeval and tracesynth | csim must agree on every transpose.
+ *
+ * Build with : gcc -g -Wall -Werror -std=c99 -m64 -O2 -o transeval -DTRANS_EVAL transeval.c transsim.c trans.c
+ *                  cachesim.c trace.c cachelab.c */
+
+#define _DEFAULT_SOURCE
+#include "cachelab.h"
+#include "cachesim.h"
+#include "transsim.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_SIZES 32
+#define DEFAULT_SIZES "32x32,64x64,61x67,255x255,257x257,512x512,1024x1024"
+
+extern trans_func_t func_list[MAX_TRANS_FUNCS];
+extern int func_counter;
+void registerFunctions(void);
+
+int trace_misses(trans_fn trans, int M, int N, const sim_config *cfg, long long *misses);
+void usage(char *argv[]);
+
+int main(int argc, char *argv[]) {
+    extern char* optarg;
+    int c, err_flag = 0, check = 0, disagree = 0;
+    char default_sizes[] = DEFAULT_SIZES;
+    char *sizes_spec = default_sizes;
+    int num_sizes = 0, rows[MAX_SIZES], cols[MAX_SIZES];
+    sim_config cfg;
+    sim_config_init(&cfg);
+
+    while((c = getopt(argc, argv, SIM_OPTIONS "m:ch")) != -1) {
+        switch(c) {
+            case 'm':
+                sizes_spec = optarg;
+                break;
+            case 'c':
+                check = 1;
+                break;
+            case 'h':
+                usage(argv);
+                return 0;
+            default:
+                if (sim_parse_option(&cfg, c, optarg) <= 0) {
+                    err_flag = 1;
+                }
+                break;
+        }
+    }
+    for (char *item = strtok(sizes_spec, ","); item != NULL; item = strtok(NULL, ",")) {
+        int m, n;
+        char rest;
+        if ((num_sizes == MAX_SIZES) || (sscanf(item, "%dx%d%c", &m, &n, &rest) != 2) || (m <= 0) || (n <= 0)) {
+            err_flag = 1;
+            break;
+        }
+        cols[num_sizes] = m;
+        rows[num_sizes] = n;
+        num_sizes++;
+    }
+    if ((num_sizes == 0) || err_flag) {
+        usage(argv);
+        return -1;
+    }
+    if (!sim_config_complete(&cfg)) {
+        cfg.s = 5;
+        cfg.assoc = 1;
+        cfg.b = 5;
+    }
+
+    registerFunctions();
+    for (int z = 0; z < num_sizes; z++) {
+        for (int f = 0; f < func_counter; f++) {
+            trans_result res;
+            if (!trans_sim_run(func_list[f].func_ptr, cols[z], rows[z], &cfg, &res)) {
+                fprintf(stderr, "could not evaluate %dx%d\n", cols[z], rows[z]);
+                return -2;
+            }
+            printf("eval func:%d M:%d N:%d correct:%d accesses:%lld hits:%lld misses:%lld evictions:%lld "
+                   "seconds:%.5f", f, cols[z], rows[z], res.correct, res.accesses, res.hits, res.misses,
+                   res.evictions, res.seconds);
+            if (check) {
+                long long misses;
+                if (!trace_misses(func_list[f].func_ptr, cols[z], rows[z], &cfg, &misses)) {
+                    fprintf(stderr, "could not trace %dx%d\n", cols[z], rows[z]);
+                    return -2;
+                }
+                printf(" trace_misses:%lld", misses);
+                disagree += (misses != res.misses);
+            }
+            printf(" desc:%s\n", func_list[f].description);
+        }
+    }
+    if (disagree) {
+        fprintf(stderr, "the traces disagree with the simulation in-process on %d transposes\n", disagree);
+        return -3;
+    }
+    return 0;
+}
+
+int trace_misses(trans_fn trans, int M, int N, const sim_config *cfg, long long *misses) {
+/* trace_misses writes the accesses of trans to a temporary trace and counts the misses of the trace as csim would */
+    char path[] = "/tmp/transeval.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return 0;
+    }
+    close(fd);
+    trans_result res;
+    simulator sim;
+    trace_writer *w = trace_create(path, TRACE_BINARY);
+    int ok = (w != NULL) && trans_sim_write(trans, M, N, TRANS_A_ADDRESS, w, &res);
+    ok = (w != NULL) && trace_finish(w) && ok;
+    trace_reader *r = ok ? trace_open(path) : NULL;
+    if ((r == NULL) || !simulator_init(&sim, cfg)) {
+        if (r != NULL) {
+            trace_close(r);
+        }
+        unlink(path);
+        return 0;
+    }
+    trace_record rec, members[TRACE_MAX_GROUP];
+    while (ok && trace_read(r, &rec)) {
+        if (rec.type == 'R') {
+            ok = trace_read_group(r, &rec, members);
+            if (ok) {
+                simulate_group(&sim, members, rec.size, rec.count);
+            }
+        } else {
+            simulate_record(&sim, &rec);
+        }
+    }
+    ok = ok && !r -> malformed;
+    coalesce_flush(&sim);
+    *misses = sim.l1d.misses;
+    trace_close(r);
+    simulator_free(&sim);
+    unlink(path);
+    return ok;
+}
+
+void usage(char *argv[]) {
+    printf("%s [-hc] [-m <MxN,...>] [csim options]\n", argv[0]);
+    printf("\nOptions:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -m <list>  Comma-separated matrix sizes, M columns by N rows (default %s).\n", DEFAULT_SIZES);
+    printf("  -c         Check that the traces tracesynth writes give the misses of the simulation in-process.\n");
+    printf("\nSimulation options, the cache defaults to -s 5 -E 1 -b 5:\n");
+    sim_print_options();
+    printf("\nExample : %s -m 32x32,64x64,61x67,128x96\n", argv[0]);
+}
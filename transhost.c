@@ -0,0 +1,214 @@
+/* transhost.c - The transposes tuned on the host and their database, see transhost.h */
+
+#define _DEFAULT_SOURCE
+#include "transhost.h"
+#include "cachelab.h"
+#include "hostperf.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+extern trans_func_t func_list[MAX_TRANS_FUNCS];
+extern int func_counter;
+void registerFunctions(void);
+void transpose_submit(int M, int N, int A[N][M], int B[M][N]);
+
+/* The tunings of the host, loaded by transpose_host_init */
+static trans_host_tuning *host_tunings;
+static int host_num_tunings, host_loaded;
+/* The geometry of the L1 data cache of the host, read by the first transpose_host_geometry */
+static trans_geometry host_geometry;
+static int host_geometry_read;
+
+int trans_host_key(char *key, int size) {
+/* The model is the first "model name" of /proc/cpuinfo, which processors without one, as most ARM ones, lack */
+    char line[TRANS_DB_MAX_LINE], model[TRANS_HOST_MAX_KEY] = "unknown";
+    FILE *fp = fopen("/proc/cpuinfo", "r");
+    while ((fp != NULL) && (fgets(line, sizeof(line), fp) != NULL)) {
+        char *colon = strchr(line, ':');
+        if ((strncmp(line, "model name", 10) == 0) && (colon != NULL)) {
+            colon += strspn(colon + 1, " \t") + 1;
+            colon[strcspn(colon, "\r\n")] = '\0';
+            snprintf(model, sizeof(model), "%s", colon);
+            break;
+        }
+    }
+    if (fp != NULL) {
+        fclose(fp);
+    }
+    /* A tab would break the database into more fields */
+    for (char *c = model; *c != '\0'; c++) {
+        *c = (*c == '\t') ? ' ' : *c;
+    }
+
+    host_cache l1d, llc;
+    int n = snprintf(key, size, "%s", model);
+    if (host_cache_read(1, &l1d) && (n < size)) {
+        n += snprintf(key + n, size - n, "/l1d:%dx%dx%d", l1d.sets, l1d.assoc, l1d.line);
+    }
+    if (host_cache_read(0, &llc) && (llc.level > 1) && (n < size)) {
+        n += snprintf(key + n, size - n, "/llc:%dx%dx%d", llc.sets, llc.assoc, llc.line);
+    }
+    return n < size;
+}
+
+static int parse_line(const char *line, char *host, trans_host_tuning *t) {
+/* parse_line reads a line of the database, and returns 0 if it is malformed */
+    trans_tuning *tiling = &t -> tiling;
+    memset(t, 0, sizeof(*t));
+    if ((sscanf(line, "%255[^\t]\t%d\t%d\t%d\t%d\t%d\t%d\t%lld\t%127[^\r\n]", host, &tiling -> M, &tiling -> N,
+                &tiling -> tile_rows, &tiling -> tile_cols, &tiling -> order, &tiling -> defer_diagonal, &t -> ns,
+                t -> variant) != 9) || (tiling -> M <= 0) || (tiling -> N <= 0)) {
+        return 0;
+    }
+    if (strcmp(t -> variant, TRANS_TILED_DESC) == 0) {
+        return (tiling -> tile_rows > 0) && (tiling -> tile_cols > 0) && (tiling -> order >= 0) &&
+               (tiling -> order < TILE_ORDERS);
+    }
+    return 1;
+}
+
+int trans_db_load(const char *path, const char *host, trans_host_tuning **tunings) {
+    char line[TRANS_DB_MAX_LINE], line_host[TRANS_HOST_MAX_KEY];
+    int num = 0, capacity = 16, line_number = 0;
+    *tunings = (trans_host_tuning *)malloc(capacity * sizeof(trans_host_tuning));
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line_number++;
+        if ((line[0] == '#') || (line[strspn(line, " \t\r\n")] == '\0')) {
+            continue;
+        }
+        if (num == capacity) {
+            capacity *= 2;
+            *tunings = (trans_host_tuning *)realloc(*tunings, capacity * sizeof(trans_host_tuning));
+        }
+        if (!parse_line(line, line_host, &(*tunings)[num])) {
+            fprintf(stderr, "%s:%d: malformed tuning\n", path, line_number);
+            fclose(fp);
+            return -1;
+        }
+        num += (strcmp(line_host, host) == 0);
+    }
+    fclose(fp);
+    return num;
+}
+
+int trans_db_store(const char *path, const char *host, const trans_host_tuning tunings[], int n) {
+/* The database is written under a temporary name and renamed into place, so that a concurrent reader sees either the
+ * old or the new one */
+    char tmp[4096], line[TRANS_DB_MAX_LINE], line_host[TRANS_HOST_MAX_KEY];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp%ld", path, (long)getpid()) >= (int)sizeof(tmp)) {
+        return 0;
+    }
+    FILE *out = fopen(tmp, "w");
+    if (out == NULL) {
+        return 0;
+    }
+    FILE *in = fopen(path, "r");
+    while ((in != NULL) && (fgets(line, sizeof(line), in) != NULL)) {
+        trans_host_tuning old;
+        int replaced = 0;
+        if ((line[0] != '#') && parse_line(line, line_host, &old) && (strcmp(line_host, host) == 0)) {
+            for (int i = 0; i < n; i++) {
+                replaced = replaced || ((tunings[i].tiling.M == old.tiling.M) && (tunings[i].tiling.N == old.tiling.N));
+            }
+        }
+        if (!replaced) {
+            fputs(line, out);
+        }
+    }
+    if (in != NULL) {
+        fclose(in);
+    }
+    for (int i = 0; i < n; i++) {
+        const trans_tuning *t = &tunings[i].tiling;
+        fprintf(out, "%s\t%d\t%d\t%d\t%d\t%d\t%d\t%lld\t%s\n", host, t -> M, t -> N, t -> tile_rows, t -> tile_cols,
+                t -> order, t -> defer_diagonal, tunings[i].ns, tunings[i].variant);
+    }
+    if ((fclose(out) != 0) || (rename(tmp, path) != 0)) {
+        unlink(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+int transpose_host_init(const char *path) {
+/* A tuning whose variant is no longer registered is dropped, the size goes back to transpose_submit */
+    char host[TRANS_HOST_MAX_KEY];
+    trans_host_tuning *tunings;
+    free(host_tunings);
+    host_tunings = NULL;
+    host_num_tunings = 0;
+    host_loaded = 1;
+    if (!trans_host_key(host, sizeof(host))) {
+        return 0;
+    }
+    int n = trans_db_load(path, host, &tunings);
+    if (n <= 0) {
+        free(tunings);
+        return n;
+    }
+    if (func_counter == 0) {
+        registerFunctions();
+    }
+    int usable = 0;
+    for (int i = 0; i < n; i++) {
+        trans_host_tuning *t = &tunings[i];
+        int found = (strcmp(t -> variant, TRANS_TILED_DESC) == 0);
+        t -> func = NULL;
+        if (strcmp(t -> variant, TRANS_GEOMETRY_DESC) == 0) {
+            t -> func = transpose_host_geometry;
+            found = 1;
+        }
+        for (int f = 0; !found && (f < func_counter); f++) {
+            if (strcmp(func_list[f].description, t -> variant) == 0) {
+                t -> func = func_list[f].func_ptr;
+                found = 1;
+            }
+        }
+        if (found) {
+            tunings[usable++] = *t;
+        }
+    }
+    host_tunings = tunings;
+    host_num_tunings = usable;
+    return usable;
+}
+
+void transpose_host(int M, int N, int A[N][M], int B[M][N]) {
+    if (!host_loaded) {
+        const char *path = getenv("TRANS_TUNING_DB");
+        transpose_host_init((path != NULL) ? path : TRANS_DB_DEFAULT);
+    }
+    for (int i = 0; i < host_num_tunings; i++) {
+        trans_host_tuning *t = &host_tunings[i];
+        if ((t -> tiling.M == M) && (t -> tiling.N == N)) {
+            if (t -> func != NULL) {
+                (*t -> func)(M, N, A, B);
+            } else {
+                transpose_tiled(M, N, A, B, &t -> tiling);
+            }
+            return;
+        }
+    }
+    transpose_submit(M, N, A, B);
+}
+
+void transpose_host_geometry(int M, int N, int A[N][M], int B[M][N]) {
+    if (!host_geometry_read) {
+        host_cache l1d;
+        const trans_geometry assignment = TRANS_GEOMETRY_ASSIGNMENT;
+        host_geometry = assignment;
+        if (host_cache_read(1, &l1d)) {
+            host_geometry.sets = l1d.sets;
+            host_geometry.assoc = l1d.assoc;
+            host_geometry.line_bytes = l1d.line;
+        }
+        host_geometry_read = 1;
+    }
+    transpose_geometry(M, N, A, B, &host_geometry);
+}
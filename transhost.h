@@ -0,0 +1,59 @@
+/* transhost.h - The transposes of trans.c tuned on the host by wall-clock time, and the database keeping the tunings
+ *
+ * The simulated cache of the assignment says little about the caches of a real processor, so hosttune times the
+ * registered transposes of trans.c, transpose_tiled on a range of tiles and transpose_geometry on the L1 data cache of
+ * the host, on the host itself and keeps the fastest for each matrix size in a database. A tuning is valid for the
+ * processor it was timed on only: the database is a text file of tab-separated lines
+ *   host  M  N  tile_rows  tile_cols  order  defer_diagonal  ns  variant
+ * where host names the model of the processor and the geometry of its L1 data and last level caches (see
+ * trans_host_key), and variant is the description of the registered transpose, TRANS_GEOMETRY_DESC for
+ * transpose_host_geometry, or TRANS_TILED_DESC for transpose_tiled with the tile given by the other fields. The lines
+ * of other hosts are kept when the database is written again, so one file can serve a whole fleet.
+ *
+ * transpose_host is the entry point for programs running on the host: the first call loads the tunings of the host
+ * from the database named by the TRANS_TUNING_DB environment variable, TRANS_DB_DEFAULT otherwise, unless
+ * transpose_host_init was called first, and every call dispatches to the tuning of its matrix size, transpose_submit
+ * when there is none. */
+
+#ifndef TRANSHOST_H
+#define TRANSHOST_H
+
+#include "trans.h"
+
+#define TRANS_DB_DEFAULT "transtune.db"
+#define TRANS_TILED_DESC "Tiled transpose"
+#define TRANS_GEOMETRY_DESC "Geometry transpose"
+#define TRANS_HOST_MAX_KEY 256
+#define TRANS_DB_MAX_LINE 1024
+
+typedef void (*trans_host_fn)(int M, int N, int A[N][M], int B[M][N]);
+
+/* A tuning of the database, for one matrix size on one host */
+typedef struct {
+    /* tiling.M and tiling.N are the size of the matrix, the tile is only used when func is a nullptr */
+    trans_tuning tiling;
+    long long ns;
+    char variant[128];
+    trans_host_fn func;
+} trans_host_tuning;
+
+/* trans_host_key writes the key of the host, the model of its processor followed by the sets, ways and line bytes of
+ * its caches, as in "AMD EPYC 7763 64-Core Processor/l1d:64x8x64/llc:32768x16x64", and returns 0 if it does not fit in
+ * size bytes */
+int trans_host_key(char *key, int size);
+/* trans_db_load reads the tunings of host from the database in path into a new array and returns their number, 0 if
+ * the database does not exist, or -1 after reporting the first malformed line */
+int trans_db_load(const char *path, const char *host, trans_host_tuning **tunings);
+/* trans_db_store replaces the tunings of host for the sizes in tunings by these, keeping every other line of the
+ * database, and returns 0 if it could not be written */
+int trans_db_store(const char *path, const char *host, const trans_host_tuning tunings[], int n);
+
+/* transpose_host_init loads the tunings of the host from path, resolving their variants among the registered
+ * transposes, and returns the number of tunings usable, or -1 if the database is malformed */
+int transpose_host_init(const char *path);
+void transpose_host(int M, int N, int A[N][M], int B[M][N]);
+/* transpose_host_geometry is transpose_geometry on the L1 data cache of the host, the cache of the assignment if it is
+ * unknown */
+void transpose_host_geometry(int M, int N, int A[N][M], int B[M][N]);
+
+#endif
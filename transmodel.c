@@ -0,0 +1,170 @@
+/* transmodel.c - The analytical model of the misses of the tiled transposes, see transmodel.h */
+
+#include "transmodel.h"
+#include "transsim.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ELEMENT_BYTES ((long long)sizeof(int))
+
+/* A line touched by the current tile */
+typedef struct {
+    long long line;
+    int set, accesses, of_b;
+} tile_line;
+
+/* The state of the model between tiles */
+typedef struct {
+    int s, E, b, num_sets;
+    /* The lines each set holds, -1 when empty, and when they were last touched */
+    long long *tags, *stamps, now;
+    /* The lines ever touched, one bit per line of A followed by those of B */
+    unsigned char *seen;
+    long long a_first_line, b_first_line, b_seen_offset;
+    /* The lines of the current tile, and per set how many lines of A and of B map to it */
+    tile_line *lines;
+    int num_lines, *set_lines[2];
+    trans_model *out;
+} model_state;
+
+static void add_row(model_state *m, long long start, int elements, int of_b) {
+/* add_row adds the lines of a run of elements starting at address start to the current tile */
+    long long end = start + elements * ELEMENT_BYTES;
+    for (long long line = start >> m -> b; line <= (end - 1) >> m -> b; line++) {
+        long long lo = (line << m -> b) > start ? (line << m -> b) : start;
+        long long hi = ((line + 1) << m -> b) < end ? ((line + 1) << m -> b) : end;
+        tile_line *l = &m -> lines[m -> num_lines++];
+        l -> line = line;
+        l -> set = (int)(line & (m -> num_sets - 1));
+        l -> accesses = (int)((hi - lo) / ELEMENT_BYTES);
+        l -> of_b = of_b;
+        m -> set_lines[of_b][l -> set]++;
+    }
+}
+
+static int resident(model_state *m, const tile_line *l) {
+    long long *tags = &m -> tags[(long long)l -> set * m -> E];
+    for (int w = 0; w < m -> E; w++) {
+        if (tags[w] == l -> line) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void model_tile(model_state *m, int i, int i_end, int j, int j_end, long long b_address, int M, int N,
+                       int inner_columns) {
+/* model_tile counts the misses of the tile of rows [i, i_end) and columns [j, j_end) of A and updates the cache */
+    m -> num_lines = 0;
+    for (int r = i; r < i_end; r++) {
+        add_row(m, TRANS_A_ADDRESS + ((long long)r * M + j) * ELEMENT_BYTES, j_end - j, 0);
+    }
+    for (int c = j; c < j_end; c++) {
+        add_row(m, b_address + ((long long)c * N + i) * ELEMENT_BYTES, i_end - i, 1);
+    }
+    /* Going along the rows of A, a line of A is only used while its row is and those of B through the whole tile, the
+     * other way round going along the columns. A line used briefly competes with the lines used throughout the tile in
+     * its set; a line used throughout with the others used throughout, and is evicted at most once by each line used
+     * briefly in its set when the ways are all taken */
+    int whole = inner_columns ? 0 : 1;
+
+    double conflict = 0;
+    for (int n = 0; n < m -> num_lines; n++) {
+        tile_line *l = &m -> lines[n];
+        long long seen_index = (l -> line >= m -> b_first_line) ? l -> line - m -> b_first_line + m -> b_seen_offset :
+                               l -> line - m -> a_first_line;
+        int w = m -> set_lines[whole][l -> set], brief = m -> set_lines[!whole][l -> set];
+        m -> out -> accesses += l -> accesses;
+        if (!(m -> seen[seen_index >> 3] & (1 << (seen_index & 7)))) {
+            m -> seen[seen_index >> 3] |= 1 << (seen_index & 7);
+            m -> out -> compulsory++;
+        } else if (!resident(m, l)) {
+            m -> out -> capacity++;
+        }
+        if (l -> of_b != whole) {
+            conflict += (w + 1 > m -> E) ? (l -> accesses - 1) * (double)(w + 1 - m -> E) / (w + 1) : 0;
+        } else if (w > m -> E) {
+            conflict += (l -> accesses - 1) * (double)(w - m -> E) / w;
+        } else if ((brief > 0) && (w + 1 > m -> E)) {
+            conflict += ((l -> accesses - 1 < brief) ? l -> accesses - 1 : brief) * (double)(w + 1 - m -> E) / w;
+        }
+    }
+    m -> out -> conflict += (long long)(conflict + 0.5);
+
+    /* Each line replaces the least recently touched line of its set, in the order the tile touched them */
+    for (int n = 0; n < m -> num_lines; n++) {
+        tile_line *l = &m -> lines[n];
+        long long *tags = &m -> tags[(long long)l -> set * m -> E];
+        long long *stamps = &m -> stamps[(long long)l -> set * m -> E];
+        int victim = 0;
+        for (int w = 0; w < m -> E; w++) {
+            if (tags[w] == l -> line) {
+                victim = w;
+                break;
+            }
+            victim = (stamps[w] < stamps[victim]) ? w : victim;
+        }
+        tags[victim] = l -> line;
+        stamps[victim] = ++m -> now;
+        m -> set_lines[0][l -> set] = 0;
+        m -> set_lines[1][l -> set] = 0;
+    }
+}
+
+int trans_model_tiled(const trans_tuning *t, int s, int E, int b, trans_model *out) {
+    int M = t -> M, N = t -> N, tile_rows = t -> tile_rows, tile_cols = t -> tile_cols;
+    if ((s < 0) || (s > 20) || (E <= 0) || (b < 2) || (b > 12) || (M <= 0) || (N <= 0) || (tile_rows <= 0) ||
+        (tile_cols <= 0)) {
+        return 0;
+    }
+    /* B is placed as trans_sim_run places it */
+    long long elements = ((long long)M * N > TRANS_DRIVER_DIM * TRANS_DRIVER_DIM) ? (long long)M * N :
+                         TRANS_DRIVER_DIM * TRANS_DRIVER_DIM;
+    long long b_address = TRANS_A_ADDRESS + elements * ELEMENT_BYTES;
+    long long matrix_bytes = (long long)M * N * ELEMENT_BYTES;
+
+    model_state m;
+    memset(&m, 0, sizeof(m));
+    memset(out, 0, sizeof(*out));
+    m.s = s;
+    m.E = E;
+    m.b = b;
+    m.num_sets = 1 << s;
+    m.out = out;
+    m.a_first_line = TRANS_A_ADDRESS >> b;
+    m.b_first_line = b_address >> b;
+    m.b_seen_offset = ((TRANS_A_ADDRESS + matrix_bytes - 1) >> b) - m.a_first_line + 1;
+    long long seen_lines = m.b_seen_offset + ((b_address + matrix_bytes - 1) >> b) - m.b_first_line + 1;
+    int rows = (tile_rows < N) ? tile_rows : N, cols = (tile_cols < M) ? tile_cols : M;
+    m.tags = (long long *)malloc((size_t)m.num_sets * E * sizeof(long long));
+    m.stamps = (long long *)calloc((size_t)m.num_sets * E, sizeof(long long));
+    m.seen = (unsigned char *)calloc((size_t)(seen_lines + 7) / 8, 1);
+    m.lines = (tile_line *)malloc(((size_t)rows * (cols * ELEMENT_BYTES / (1 << b) + 2) +
+                                   (size_t)cols * (rows * ELEMENT_BYTES / (1 << b) + 2)) * sizeof(tile_line));
+    m.set_lines[0] = (int *)calloc(m.num_sets, sizeof(int));
+    m.set_lines[1] = (int *)calloc(m.num_sets, sizeof(int));
+    int ok = (m.tags != NULL) && (m.stamps != NULL) && (m.seen != NULL) && (m.lines != NULL) &&
+             (m.set_lines[0] != NULL) && (m.set_lines[1] != NULL);
+    if (ok) {
+        for (long long w = 0; w < (long long)m.num_sets * E; w++) {
+            m.tags[w] = -1;
+        }
+        /* The tiles are visited in the order of transpose_tiled */
+        int rows_of_tiles = (N + tile_rows - 1) / tile_rows, cols_of_tiles = (M + tile_cols - 1) / tile_cols;
+        int columns_first = (t -> order & TILE_COLUMNS_FIRST) != 0;
+        for (int k = 0; k < rows_of_tiles * cols_of_tiles; k++) {
+            int i = (columns_first ? k % rows_of_tiles : k / cols_of_tiles) * tile_rows;
+            int j = (columns_first ? k / rows_of_tiles : k % cols_of_tiles) * tile_cols;
+            model_tile(&m, i, (i + tile_rows < N) ? i + tile_rows : N, j, (j + tile_cols < M) ? j + tile_cols : M,
+                       b_address, M, N, (t -> order & TILE_INNER_COLUMNS) != 0);
+        }
+        out -> misses = out -> compulsory + out -> capacity + out -> conflict;
+    }
+    free(m.tags);
+    free(m.stamps);
+    free(m.seen);
+    free(m.lines);
+    free(m.set_lines[0]);
+    free(m.set_lines[1]);
+    return ok;
+}
@@ -0,0 +1,33 @@
+/* transmodel.h - Predicts the misses of the tiled transposes of trans.c without simulating their accesses
+ *
+ * The model works a tile at a time rather than an access at a time. The lines of A and B a tile touches follow from
+ * the addresses of the matrices in the driver (see transsim.h), M, N and the tile, and so do the sets they map to and
+ * the number of accesses to each. Per tile, a line misses on its first access unless it is still in the cache from the
+ * previous tiles: a compulsory miss if it was never touched before, a capacity miss otherwise. The further accesses to
+ * a line miss when the lines it competes with in its set outnumber the ways, as the transposes interleave the accesses
+ * to A and B: with k lines competing on E ways, each with probability (k - E) / k, a conflict miss. Which lines compete
+ * depends on the order of the elements within the tile, see model_tile. At the end of a tile, each set keeps the last
+ * E lines the tile touched in it.
+ *
+ * The deferral of the diagonal is not modelled and the estimates are rough, within 10 to 20% on the square matrices of
+ * the assignment and further off on 61x67: the model ranks the candidates, it does not replace the simulator. A
+ * prediction costs a few operations per line rather than per access, microseconds for the matrices of the assignment,
+ * and transtune uses it to simulate only the candidates it predicts best. Only caches indexed by the low bits of the
+ * line address with LRU replacement, the defaults of csim, are modelled. */
+
+#ifndef TRANSMODEL_H
+#define TRANSMODEL_H
+
+#include "trans.h"
+
+typedef struct {
+    long long accesses, compulsory, capacity, conflict;
+    /* The sum of the three kinds of misses, rounded */
+    long long misses;
+} trans_model;
+
+/* trans_model_tiled predicts the misses of transpose_tiled with the tuning t, for its M and N, on a cache of 2^s sets
+ * of E lines of 2^b bytes, and returns 0 if the cache or the tile is not valid or memory runs out */
+int trans_model_tiled(const trans_tuning *t, int s, int E, int b, trans_model *out);
+
+#endif
@@ -0,0 +1,128 @@
+/* transsim.c - Simulates the transposes of trans.c while they run, see transsim.h */
+
+#define _DEFAULT_SOURCE
+#include "transsim.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/* The simulation in progress, or the trace being written, nullptrs outside of trans_sim_run and trans_sim_write */
+static simulator *current;
+static trace_writer *writer;
+static int write_ok;
+static const char *a_lo, *a_hi, *b_lo, *b_hi;
+static long long a_address, b_address, accesses;
+
+static void simulate(const int *p, char type) {
+/* simulate maps an element of A or B to its address in the driver and simulates or writes its access */
+    const char *c = (const char *)p;
+    long long address = (long long)(uintptr_t)p;
+    if ((c >= a_lo) && (c < a_hi)) {
+        address = a_address + (c - a_lo);
+    } else if ((c >= b_lo) && (c < b_hi)) {
+        address = b_address + (c - b_lo);
+    }
+    trace_record rec;
+    rec.address = address;
+    rec.stride = 0;
+    rec.count = 1;
+    rec.asid = -1;
+    rec.size = sizeof(int);
+    rec.type = type;
+    if (current != NULL) {
+        simulate_record(current, &rec);
+    } else {
+        write_ok = trace_write(writer, &rec) && write_ok;
+    }
+    accesses++;
+}
+
+void trans_sim_load(const int *p) {
+    if ((current != NULL) || (writer != NULL)) {
+        simulate(p, 'L');
+    }
+}
+
+int trans_sim_store(int *p, int v) {
+    if ((current != NULL) || (writer != NULL)) {
+        simulate(p, 'S');
+    }
+    return v;
+}
+
+static int run(trans_fn trans, int M, int N, long long a, simulator *sim, trace_writer *out, trans_result *res) {
+/* run runs trans on the matrices of the driver, A at address a, handing its accesses to sim or to out. The matrices
+ * are allocated as the driver does, B TRANS_DRIVER_DIM^2 elements after A unless A is larger */
+    long long elements = ((long long)M * N > TRANS_DRIVER_DIM * TRANS_DRIVER_DIM) ? (long long)M * N :
+                         TRANS_DRIVER_DIM * TRANS_DRIVER_DIM;
+    int *storage = (int *)malloc(2 * elements * sizeof(int));
+    if (storage == NULL) {
+        return 0;
+    }
+    int (*A)[M] = (int (*)[M])storage;
+    int (*B)[N] = (int (*)[N])(storage + elements);
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < M; j++) {
+            A[i][j] = i * M + j;
+        }
+    }
+    memset(B, 0, (size_t)M * N * sizeof(int));
+
+    a_lo = (const char *)A;
+    a_hi = a_lo + (size_t)M * N * sizeof(int);
+    b_lo = (const char *)B;
+    b_hi = b_lo + (size_t)M * N * sizeof(int);
+    a_address = a;
+    b_address = a + elements * (long long)sizeof(int);
+    accesses = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    current = sim;
+    writer = out;
+    (*trans)(M, N, A, B);
+    current = NULL;
+    writer = NULL;
+    if (sim != NULL) {
+        coalesce_flush(sim);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    res -> correct = 1;
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < M; j++) {
+            res -> correct = res -> correct && (A[i][j] == B[j][i]);
+        }
+    }
+    res -> accesses = accesses;
+    res -> seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    free(storage);
+    return 1;
+}
+
+int trans_sim_run(trans_fn trans, int M, int N, const sim_config *cfg, trans_result *res) {
+    simulator sim;
+    if (!simulator_init(&sim, cfg)) {
+        return 0;
+    }
+    if (!run(trans, M, N, TRANS_A_ADDRESS, &sim, NULL, res)) {
+        simulator_free(&sim);
+        return 0;
+    }
+    res -> hits = sim.l1d.hits;
+    res -> misses = sim.l1d.misses;
+    res -> evictions = sim.l1d.evictions;
+    simulator_free(&sim);
+    return 1;
+}
+
+int trans_sim_write(trans_fn trans, int M, int N, long long a, trace_writer *out, trans_result *res) {
+    write_ok = 1;
+    if (!run(trans, M, N, a, NULL, out, res)) {
+        return 0;
+    }
+    res -> hits = 0;
+    res -> misses = 0;
+    res -> evictions = 0;
+    return write_ok;
+}
@@ -0,0 +1,41 @@
+/* transsim.h - Simulates the transposes of trans.c while they run, without tracing them first
+ *
+ * trans.c compiled with -DTRANS_EVAL calls trans_sim_load and trans_sim_store on every access to the matrices (see
+ * LOAD and STORE there). During trans_sim_run they are simulated right away, at the addresses the matrices have in the
+ * driver of the assignment: A at TRANS_A_ADDRESS and B right after the rows the driver allocates for A, as tracesynth
+ * lays them out. The results are thus those of valgrind and csim on the driver, bar the accesses to the stack which
+ * are not counted, and do not depend on where the matrices happen to be allocated. trans_sim_write writes the same
+ * accesses to a trace instead, which is how tracesynth generates the traces of the transposes. Outside of trans_sim_run
+ * and trans_sim_write the calls do nothing. */
+
+#ifndef TRANSSIM_H
+#define TRANSSIM_H
+
+#include "cachesim.h"
+
+#define TRANS_A_ADDRESS 0x30b080LL
+/* The rows and columns the driver allocates for each matrix */
+#define TRANS_DRIVER_DIM 256
+
+typedef void (*trans_fn)(int M, int N, int A[N][M], int B[M][N]);
+
+/* The outcome of running a transpose */
+typedef struct {
+    int correct;
+    long long accesses, hits, misses, evictions;
+    double seconds;
+} trans_result;
+
+void trans_sim_load(const int *p);
+/* trans_sim_store returns v, so that the store hook runs after the load of the value stored */
+int trans_sim_store(int *p, int v);
+
+/* trans_sim_run runs trans on an N*M matrix A, simulating its accesses on the cache described by cfg, checks that B
+ * is the transpose of A and returns 0 if the cache cannot be simulated or the matrices cannot be allocated */
+int trans_sim_run(trans_fn trans, int M, int N, const sim_config *cfg, trans_result *res);
+/* trans_sim_write runs trans as trans_sim_run does but writes its accesses to out, with A at address a rather than
+ * TRANS_A_ADDRESS, and sets the correctness and the accesses of res only. It returns 0 if the matrices cannot be
+ * allocated or the trace cannot be written */
+int trans_sim_write(trans_fn trans, int M, int N, long long a, trace_writer *out, trans_result *res);
+
+#endif
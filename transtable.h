@@ -0,0 +1,7 @@
+/* transtable.h - The tunings consulted by transpose_submit, see trans.h. Written by transtune, do not edit */
+
+static const trans_tuning trans_table[] = {
+    /* M, N, s, E, b, tile_rows, tile_cols, order, defer_diagonal */
+    {61, 67, 5, 1, 5, 14, 1, 0, 0}, /* 1804 misses, 1967 untuned */
+    {0}
+};
@@ -0,0 +1,268 @@
+/* transtune.c - Searches the tiled transposes of trans.c for the one with the fewest simulated misses and writes the
+ * tuning table transpose_submit consults (see trans.h).
+ * Required inputs : none, the matrix sizes and the cache have defaults
+ *
+ * For each of the -m sizes, the 32x32, 64x64 and 61x67 of the assignment by default, the candidates are the tiles of 1
+ * to -k rows by 1 to -k columns in each of the TILE_ORDERS orders, with and without the deferral of the diagonal, on
+ * the cache described by the options of csim, the 1KB direct mapped cache with 32 byte blocks of the assignment by
+ * default. The misses of every candidate are first predicted by the model of transmodel.h, and only the -p tiles and
+ * orders predicted best are simulated, in-process as transeval does, trans.c being compiled with -DTRANS_EVAL. -p 0
+ * simulates them all. One line is printed per size:
+ *   tune M:61 N:67 s:5 E:1 b:5 tile_rows:14 tile_cols:1 order:0 defer:0 misses:1804 untuned_misses:1967
+ *        predicted:1914 candidates:8192 simulated:128 model_seconds:0.189
+ * all on one line, the best tuning found, the misses of transpose_untuned, what transpose_submit does without one,
+ * and the misses the model predicted for the tuning found. With -o, the tunings which beat transpose_untuned are
+ * written to the file as the table of transtable.h; the other sizes are left out so that transpose_submit keeps its
+ * blocking for them. Ties go to the first tuning found, the smallest tiles in row order.
+ *
+ * Build with : gcc -g -Wall -Werror -std=c99 -m64 -O2 -o transtune -DTRANS_EVAL transtune.c transmodel.c transsim.c
+ *                  trans.c cachesim.c trace.c cachelab.c
+ * then       : ./transtune -o transtable.h, and rebuild trans.c */
+
+#define _DEFAULT_SOURCE
+#include "cachesim.h"
+#include "transsim.h"
+#include "trans.h"
+#include "transmodel.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_SIZES 32
+#define DEFAULT_SIZES "32x32,64x64,61x67"
+#define DEFAULT_MAX_TILE 32
+#define DEFAULT_PRUNE 64
+
+/* A candidate tile and order, with the misses the model predicts for it */
+typedef struct {
+    trans_tuning tuning;
+    long long predicted;
+    int index;
+} tune_candidate;
+
+/* What tune found */
+typedef struct {
+    trans_tuning best;
+    long long misses, predicted;
+    int candidates, simulated;
+    double model_seconds;
+} tune_outcome;
+
+/* The tuning the candidate run by trans_sim_run uses, which takes a transpose without a tuning */
+static const trans_tuning *candidate;
+
+static void transpose_candidate(int M, int N, int A[N][M], int B[M][N]) {
+    transpose_tiled(M, N, A, B, candidate);
+}
+
+int tune(int M, int N, const sim_config *cfg, int max_tile, int prune, tune_outcome *outcome);
+int compare_predicted(const void *a, const void *b);
+int compare_index(const void *a, const void *b);
+double seconds_now(void);
+void usage(char *argv[]);
+
+int main(int argc, char *argv[]) {
+    extern char* optarg;
+    int c, err_flag = 0, max_tile = DEFAULT_MAX_TILE, prune = DEFAULT_PRUNE;
+    char default_sizes[] = DEFAULT_SIZES;
+    char *sizes_spec = default_sizes, *out_file = NULL;
+    int num_sizes = 0, rows[MAX_SIZES], cols[MAX_SIZES];
+    sim_config cfg;
+    sim_config_init(&cfg);
+
+    while((c = getopt(argc, argv, SIM_OPTIONS "m:k:p:o:h")) != -1) {
+        switch(c) {
+            case 'm':
+                sizes_spec = optarg;
+                break;
+            case 'k':
+                max_tile = atoi(optarg);
+                if (max_tile <= 0) {
+                    err_flag = 1;
+                }
+                break;
+            case 'p':
+                prune = atoi(optarg);
+                if (prune < 0) {
+                    err_flag = 1;
+                }
+                break;
+            case 'o':
+                out_file = optarg;
+                break;
+            case 'h':
+                usage(argv);
+                return 0;
+            default:
+                if (sim_parse_option(&cfg, c, optarg) <= 0) {
+                    err_flag = 1;
+                }
+                break;
+        }
+    }
+    for (char *item = strtok(sizes_spec, ","); item != NULL; item = strtok(NULL, ",")) {
+        int m, n;
+        char rest;
+        if ((num_sizes == MAX_SIZES) || (sscanf(item, "%dx%d%c", &m, &n, &rest) != 2) || (m <= 0) || (n <= 0)) {
+            err_flag = 1;
+            break;
+        }
+        cols[num_sizes] = m;
+        rows[num_sizes] = n;
+        num_sizes++;
+    }
+    if ((num_sizes == 0) || err_flag) {
+        usage(argv);
+        return -1;
+    }
+    if (!sim_config_complete(&cfg)) {
+        cfg.s = TRANS_CACHE_S;
+        cfg.assoc = TRANS_CACHE_E;
+        cfg.b = TRANS_CACHE_B;
+    }
+
+    tune_outcome tuned[MAX_SIZES];
+    long long untuned_misses[MAX_SIZES];
+    for (int z = 0; z < num_sizes; z++) {
+        trans_result res;
+        tune_outcome *o = &tuned[z];
+        if (!trans_sim_run(transpose_untuned, cols[z], rows[z], &cfg, &res) ||
+            !tune(cols[z], rows[z], &cfg, max_tile, prune, o)) {
+            fprintf(stderr, "could not evaluate %dx%d\n", cols[z], rows[z]);
+            return -2;
+        }
+        untuned_misses[z] = res.misses;
+        printf("tune M:%d N:%d s:%d E:%d b:%d tile_rows:%d tile_cols:%d order:%d defer:%d misses:%lld "
+               "untuned_misses:%lld predicted:%lld candidates:%d simulated:%d model_seconds:%.3f\n", cols[z], rows[z],
+               cfg.s, cfg.assoc, cfg.b, o -> best.tile_rows, o -> best.tile_cols, o -> best.order,
+               o -> best.defer_diagonal, o -> misses, untuned_misses[z], o -> predicted, o -> candidates,
+               o -> simulated, o -> model_seconds);
+    }
+
+    if (out_file != NULL) {
+        FILE *fp = fopen(out_file, "w");
+        if (fp == NULL) {
+            fprintf(stderr, "could not open %s\n", out_file);
+            return -3;
+        }
+        fprintf(fp, "/* transtable.h - The tunings consulted by transpose_submit, see trans.h. Written by transtune, "
+                "do not edit */\n\nstatic const trans_tuning trans_table[] = {\n");
+        fprintf(fp, "    /* M, N, s, E, b, tile_rows, tile_cols, order, defer_diagonal */\n");
+        for (int z = 0; z < num_sizes; z++) {
+            trans_tuning *t = &tuned[z].best;
+            if (tuned[z].misses < untuned_misses[z]) {
+                fprintf(fp, "    {%d, %d, %d, %d, %d, %d, %d, %d, %d}, /* %lld misses, %lld untuned */\n", t -> M,
+                        t -> N, t -> s, t -> E, t -> b, t -> tile_rows, t -> tile_cols, t -> order,
+                        t -> defer_diagonal, tuned[z].misses, untuned_misses[z]);
+            }
+        }
+        fprintf(fp, "    {0}\n};\n");
+        if (fclose(fp) != 0) {
+            fprintf(stderr, "could not write %s\n", out_file);
+            return -3;
+        }
+    }
+    return 0;
+}
+
+int tune(int M, int N, const sim_config *cfg, int max_tile, int prune, tune_outcome *outcome) {
+/* tune predicts the misses of every tile and order of an N*M matrix, simulates the prune best with and without the
+ * deferral of the diagonal, or all of them if prune is 0, and keeps the correct one with the fewest misses. It returns
+ * 0 if the cache cannot be simulated or modelled */
+    int max_rows = (max_tile < N) ? max_tile : N, max_cols = (max_tile < M) ? max_tile : M;
+    int num = 0;
+    tune_candidate *cands = (tune_candidate *)malloc((size_t)max_rows * max_cols * TILE_ORDERS *
+                                                     sizeof(tune_candidate));
+    if (cands == NULL) {
+        return 0;
+    }
+    trans_tuning t;
+    t.M = M;
+    t.N = N;
+    t.s = cfg -> s;
+    t.E = cfg -> assoc;
+    t.b = cfg -> b;
+    t.defer_diagonal = 0;
+    double start = seconds_now();
+    for (t.tile_rows = 1; t.tile_rows <= max_rows; t.tile_rows++) {
+        for (t.tile_cols = 1; t.tile_cols <= max_cols; t.tile_cols++) {
+            for (t.order = 0; t.order < TILE_ORDERS; t.order++) {
+                trans_model model;
+                if (!trans_model_tiled(&t, t.s, t.E, t.b, &model)) {
+                    free(cands);
+                    return 0;
+                }
+                cands[num].tuning = t;
+                cands[num].predicted = model.misses;
+                cands[num].index = num;
+                num++;
+            }
+        }
+    }
+    outcome -> model_seconds = seconds_now() - start;
+    outcome -> candidates = 2 * num;
+    /* The candidates kept are simulated in the order they were enumerated, so that ties go to the first as without
+     * pruning */
+    int kept = ((prune == 0) || (prune > num)) ? num : prune;
+    qsort(cands, num, sizeof(tune_candidate), compare_predicted);
+    qsort(cands, kept, sizeof(tune_candidate), compare_index);
+
+    outcome -> misses = -1;
+    outcome -> simulated = 0;
+    for (int k = 0; k < kept; k++) {
+        t = cands[k].tuning;
+        candidate = &t;
+        for (t.defer_diagonal = 0; t.defer_diagonal <= 1; t.defer_diagonal++) {
+            trans_result res;
+            if (!trans_sim_run(transpose_candidate, M, N, cfg, &res)) {
+                free(cands);
+                return 0;
+            }
+            outcome -> simulated++;
+            if (res.correct && ((outcome -> misses < 0) || (res.misses < outcome -> misses))) {
+                outcome -> best = t;
+                outcome -> misses = res.misses;
+                outcome -> predicted = cands[k].predicted;
+            }
+        }
+    }
+    candidate = NULL;
+    free(cands);
+    return 1;
+}
+
+int compare_predicted(const void *a, const void *b) {
+/* compare_predicted orders the candidates by predicted misses, then as they were enumerated */
+    const tune_candidate *x = (const tune_candidate *)a, *y = (const tune_candidate *)b;
+    if (x -> predicted != y -> predicted) {
+        return (x -> predicted < y -> predicted) ? -1 : 1;
+    }
+    return x -> index - y -> index;
+}
+
+int compare_index(const void *a, const void *b) {
+    return ((const tune_candidate *)a) -> index - ((const tune_candidate *)b) -> index;
+}
+
+double seconds_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void usage(char *argv[]) {
+    printf("%s [-h] [-m <MxN,...>] [-k <num>] [-p <num>] [-o <file>] [csim options]\n", argv[0]);
+    printf("\nOptions:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -m <list>  Comma-separated matrix sizes, M columns by N rows (default %s).\n", DEFAULT_SIZES);
+    printf("  -k <num>   Largest number of rows or columns of a tile (default %d).\n", DEFAULT_MAX_TILE);
+    printf("  -p <num>   Number of tiles and orders predicted best which are simulated, 0 for all (default %d).\n",
+           DEFAULT_PRUNE);
+    printf("  -o <file>  Write the tunings which beat the untuned transpose as a table, transtable.h.\n");
+    printf("\nSimulation options, the cache defaults to -s %d -E %d -b %d:\n", TRANS_CACHE_S, TRANS_CACHE_E,
+           TRANS_CACHE_B);
+    sim_print_options();
+    printf("\nExample : %s -m 32x32,64x64,61x67 -o transtable.h\n", argv[0]);
+}